@@ -0,0 +1,27 @@
+//******************************************************************************
+//	Settings of main.c for GEN_CONFIG, generated by host/confgen.c,
+//	do not edit. Options: -f 200 -p 10 -c 50 -s
+//
+//	Targets: no tone below 200 Hz over 0.50 % (envelope levels),
+//		fades 10.00 10.00 10.00 10.00 s +-10 %, busiest tick <= 50 %
+//	Result: tick 7812.5 Hz, busiest tick 43.2 % of the shortest (simulated),
+//		fades 10.22 10.22 10.22 10.22 s
+//******************************************************************************
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#define TICK_CYCLES		2048
+#define SPREAD_TICK		1
+#define LOOP_SPEED		11
+
+#define MAX_CH_0_2		234
+#define STEPS_CH_0_2	39
+#define MAX_CH_3_5		234
+#define STEPS_CH_3_5	39
+#define MAX_CH_6_7		234
+#define STEPS_CH_6_7	39
+#define MAX_CH_8_9		234
+#define STEPS_CH_8_9	39
+
+#endif
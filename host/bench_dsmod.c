@@ -0,0 +1,213 @@
+//******************************************************************************
+//	libdsmod benchmark - call overhead and separate instances in threads
+//
+//	Description:
+//		Linked against libdsmod.so, so every call goes through the
+//		dynamic linker's PLT as it does from another language.
+//			calls		ns per call of dsmod_generate() for blocks of 0
+//						(the call alone), 1, 16, 256 and 4096 frames, and
+//						of dsmod_set_requests() for all channels and
+//						dsmod_get_stats()
+//			threads		1, 2, 4 ... -j threads (default 4) with an
+//						instance each run the same -t ticks (default 4 M)
+//						of blocks of 256, new pseudo-random requests every
+//						CHANGE ticks, and report frames per second in all
+//		Every thread has to give the same frames (FNV-1a hash) as the
+//		first run, and the lit counts of dsmod_get_stats() have to match
+//		the frames. The error returns are checked once at the start.
+//
+//	Build:
+//		gcc -O2 -fPIC -fvisibility=hidden -shared -Ihost -o libdsmod.so
+//			host/engine.c host/sim.c host/dsmod.c -lm
+//		gcc -O2 -Ihost -o bench_dsmod host/bench_dsmod.c -L. -ldsmod
+//			-Wl,-rpath,'$ORIGIN' -lpthread
+//	Run:
+//		./bench_dsmod [-j threads] [-t ticks]
+//******************************************************************************
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "dsmod.h"
+
+#define CHANGE			4096	// Ticks between new requests, multiple of BLOCK
+#define BLOCK			256		// Frames per call in the thread runs
+#define BIG				4096	// Largest block of the call table
+#define THREADS			64
+
+static const size_t callLen[] = { 0, 1, 16, 256, BIG };
+
+typedef struct {
+	pthread_t id;
+	unsigned long ticks;
+	unsigned long hash;
+	int statsOk;
+} job;
+
+static double now(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void levels(dsmod *d, unsigned long *rnd) {
+//	New requests for every channel, 0 ... 255, the library clamps to max
+	uint8_t r[DSMOD_CH];
+	uint32_t n;
+
+	for (n = 0; n < dsmod_channels(); ++n) {
+		*rnd = *rnd * 1103515245 + 12345;
+		r[n] = *rnd >> 16;
+	}
+	dsmod_set_requests(d, 0, r, dsmod_channels());
+}
+
+static void *run(void *arg) {
+//------------------------------------------------------------------------------
+// One instance for job->ticks frames, hash of the frames and a check of the
+// lit counts in *job
+//------------------------------------------------------------------------------
+	job *j = arg;
+	uint32_t frames[BLOCK];
+	uint64_t lit[DSMOD_CH] = { 0 };
+	unsigned long rnd = 12345, t, h = 2166136261UL;
+	dsmod_stats s;
+	dsmod *d;
+	uint32_t n;
+	int i;
+
+	if (!(d = dsmod_new())) {
+		j->statsOk = 0;
+		return NULL;
+	}
+	for (t = 0; t < j->ticks; t += BLOCK) {
+		if (!(t % CHANGE))
+			levels(d, &rnd);
+		dsmod_generate(d, frames, BLOCK);
+		for (i = 0; i < BLOCK; ++i) {
+			h = ((h ^ frames[i]) * 16777619UL) & 0xFFFFFFFFUL;
+			for (n = 0; n < dsmod_channels(); ++n)
+				lit[n] += frames[i] >> n & 1;
+		}
+	}
+	s.size = sizeof(s);
+	dsmod_get_stats(d, &s);
+	j->statsOk = s.ticks == j->ticks && s.calls == j->ticks / BLOCK;
+	for (n = 0; n < dsmod_channels(); ++n)
+		j->statsOk &= s.lit[n] == lit[n];
+	j->hash = h;
+	dsmod_free(d);
+	return NULL;
+}
+
+static int errors(void) {
+//	The error returns and caller memory, 0 = as dsmod.h says
+	static union { uint64_t align; unsigned char b[4096]; } mem;
+	uint8_t v[2] = { 0, 6 };
+	uint32_t f;
+	dsmod *d;
+	int fail = 0;
+
+	if (dsmod_size() > sizeof(mem) || !(d = dsmod_init(&mem, sizeof(mem))))
+		return 1;
+	fail |= dsmod_init(&mem, dsmod_size() - 1) != NULL;
+	fail |= dsmod_set_requests(d, dsmod_channels() - 1, v, 2) != DSMOD_ERANGE;
+	fail |= dsmod_set_requests(NULL, 0, v, 1) != DSMOD_EINVAL;
+	fail |= dsmod_set_max(d, 0, v, 1) != DSMOD_EMAX;
+	fail |= dsmod_policy(dsmod_channels()) != DSMOD_ERANGE;
+	fail |= dsmod_generate(d, NULL, 1) != DSMOD_EINVAL;
+	fail |= dsmod_generate(d, &f, 1) != DSMOD_OK;
+	return fail;
+}
+
+int main(int argc, char **argv) {
+	static uint32_t frames[BIG];
+	static job jobs[THREADS];
+	unsigned long ticks = 1UL << 22, calls, c, hash0 = 0;
+	uint8_t r[DSMOD_CH] = { 0 };
+	dsmod_stats s;
+	dsmod *d;
+	double t0, t;
+	int opt, threads = 4, nt, i, k, fail;
+
+	while ((opt = getopt(argc, argv, "j:t:")) != -1) {
+		if (opt == 'j')
+			threads = atoi(optarg);
+		else if (opt == 't')
+			ticks = strtoul(optarg, NULL, 0);
+		else {
+			fprintf(stderr, "usage: bench_dsmod [-j threads] [-t ticks]\n");
+			return 2;
+		}
+	}
+	if (threads < 1 || threads > THREADS) {
+		fprintf(stderr, "bench_dsmod: 1 ... %d threads\n", THREADS);
+		return 2;
+	}
+	ticks = (ticks + CHANGE - 1) / CHANGE * CHANGE;
+	if (dsmod_abi() != DSMOD_ABI) {
+		printf("libdsmod ABI %u, built against %d\nFAIL\n", dsmod_abi(),
+				DSMOD_ABI);
+		return 1;
+	}
+	fail = errors();
+	printf("libdsmod ABI %u, %u channels, %zu bytes per instance, "
+			"error returns %s\n", dsmod_abi(), dsmod_channels(), dsmod_size(),
+			fail ? "wrong" : "ok");
+
+	d = dsmod_new();
+	c = 12345;
+	levels(d, &c);
+	printf("%-22s %10s %10s\n", "call", "ns/call", "ns/frame");
+	for (k = 0; k < (int)(sizeof(callLen) / sizeof(callLen[0])); ++k) {
+		calls = callLen[k] ? ticks / callLen[k] : ticks;
+		t0 = now();
+		for (c = 0; c < calls; ++c)
+			dsmod_generate(d, frames, callLen[k]);
+		t = now() - t0;
+		printf("generate %-13zu %10.2f", callLen[k], 1e9 * t / calls);
+		if (callLen[k])
+			printf(" %10.2f", 1e9 * t / (calls * callLen[k]));
+		printf("\n");
+	}
+	t0 = now();
+	for (c = 0; c < ticks; ++c) {
+		r[0] = c;
+		dsmod_set_requests(d, 0, r, dsmod_channels());
+	}
+	printf("%-22s %10.2f\n", "set_requests all", 1e9 * (now() - t0) / ticks);
+	s.size = sizeof(s);
+	t0 = now();
+	for (c = 0; c < ticks; ++c)
+		dsmod_get_stats(d, &s);
+	printf("%-22s %10.2f\n", "get_stats", 1e9 * (now() - t0) / ticks);
+	dsmod_free(d);
+
+	printf("\n%-8s %14s  %s\n", "threads", "frames/s", "frames");
+	for (nt = 1; ; nt = nt << 1 < threads ? nt << 1 : threads) {
+		t0 = now();
+		for (i = 0; i < nt; ++i) {
+			jobs[i].ticks = ticks;
+			pthread_create(&jobs[i].id, NULL, run, &jobs[i]);
+		}
+		for (i = 0; i < nt; ++i)
+			pthread_join(jobs[i].id, NULL);
+		t = now() - t0;
+		if (nt == 1)
+			hash0 = jobs[0].hash;
+		printf("%-8d %14.0f ", nt, nt * ticks / t);
+		for (i = 0; i < nt; ++i) {
+			fail |= jobs[i].hash != hash0 || !jobs[i].statsOk;
+			printf(" %08lx%s", jobs[i].hash, jobs[i].hash != hash0 ? " differ" :
+					!jobs[i].statsOk ? " stats" : "");
+		}
+		printf("\n");
+		if (nt == threads)
+			break;
+	}
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
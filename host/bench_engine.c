@@ -0,0 +1,113 @@
+//******************************************************************************
+//	Engine benchmark - block generation against stepping one tick at a time
+//
+//	Description:
+//		Generates the same -t ticks (default 4 M) of frames in turn with
+//			step		engine_step(), calc_output_bits() of the firmware
+//						called once per tick on its globals
+//			block N		engine_generate() in blocks of N ticks, N = 1,
+//						16, 256 and 4096
+//		and reports the time per tick and frames per second of each. A
+//		host sets new pseudo-random levels on every channel each CHANGE
+//		ticks, the same for all, between blocks. Every run has to give
+//		the same frames as step (FNV-1a hash), so the block kernel is
+//		checked against the firmware function for the -D of this build.
+//
+//	Build:
+//		gcc -O2 -Ihost -o bench_engine host/engine.c host/sim.c
+//			host/bench_engine.c -lm
+//	Run:
+//		./bench_engine [-t ticks]
+//		e.g. rebuilt with -DNTF_SHAPED=1, -DDITHER=1 or -DMOD_CH_0_2=MOD_PWM
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "engine.h"
+
+#define CHANGE			4096	// Ticks between new levels, multiple of BLOCK
+#define BLOCK			4096	// Largest block
+#define RUNS			5
+
+// Frames per call of each run, 0 = engine_step()
+static const unsigned long blockLen[RUNS] = { 0, 1, 16, 256, BLOCK };
+static unsigned int frames[BLOCK];
+
+static void levels(engine *e, unsigned long *rnd) {
+//	New levels for every channel, 0 ... max
+	int n;
+
+	for (n = 0; n < engineChannels; ++n) {
+		*rnd = *rnd * 1103515245 + 12345;
+		e->req[n] = (*rnd >> 16) % (e->max[n] + 1);
+	}
+}
+
+static unsigned long hash(unsigned long h, const unsigned int *f,
+		unsigned long n) {
+	while (n--)
+		h = ((h ^ *f++) * 16777619UL) & 0xFFFFFFFFUL;
+	return h;
+}
+
+static double run(unsigned long len, unsigned long ticks, unsigned long *h) {
+//------------------------------------------------------------------------------
+// Seconds for ticks frames in blocks of len (0 = engine_step()), hash in *h
+//------------------------------------------------------------------------------
+	struct timespec t0, t1;
+	unsigned long rnd = 12345, t, i, j, k;
+	engine e;
+
+	engine_init(&e);
+	*h = 2166136261UL;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (t = 0; t < ticks; t += CHANGE) {
+		levels(&e, &rnd);
+		for (i = 0; i < CHANGE; i += k) {
+			k = len ? len : BLOCK;
+			if (len)
+				engine_generate(&e, frames, k);
+			else
+				for (j = 0; j < k; ++j)
+					frames[j] = engine_step(&e);
+			*h = hash(*h, frames, k);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+}
+
+int main(int argc, char **argv) {
+	unsigned long ticks = 1UL << 22, h[RUNS];
+	double s[RUNS];
+	int opt, r, fail = 0;
+
+	while ((opt = getopt(argc, argv, "t:")) != -1) {
+		if (opt == 't')
+			ticks = strtoul(optarg, NULL, 0);
+		else {
+			fprintf(stderr, "usage: bench_engine [-t ticks]\n");
+			return 2;
+		}
+	}
+	ticks = (ticks + CHANGE - 1) / CHANGE * CHANGE;
+
+	printf("%lu ticks, %d channels, new levels every %d ticks\n", ticks,
+			engineChannels, CHANGE);
+	printf("%-12s %10s %14s %8s  %s\n", "method", "ns/tick", "frames/s",
+			"speedup", "frames");
+	for (r = 0; r < RUNS; ++r) {
+		s[r] = run(blockLen[r], ticks, &h[r]);
+		fail |= h[r] != h[0];
+		if (r)
+			printf("block %-6lu", blockLen[r]);
+		else
+			printf("%-12s", "step");
+		printf(" %10.2f %14.0f %7.1fx  %08lx%s\n", 1e9 * s[r] / ticks,
+				ticks / s[r], s[0] / s[r], h[r], h[r] != h[0] ? " differ" : "");
+	}
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
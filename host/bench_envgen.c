@@ -0,0 +1,198 @@
+//******************************************************************************
+//	Envelope generator check and benchmark - envgen.h
+//
+//	Description:
+//		First the shipped envelopes of main.c are written as generators,
+//		one per channel, each a loop over the phases of its group that
+//		fades up in one phase, down in another and holds otherwise. For
+//		two full envelope cycles they have to give the same req[] as
+//		calc_CH_*() after every step.
+//
+//		Then -g generators (default 4096) of pseudo-random shows, fades
+//		of 1 ... 64 steps to random levels with holds of 0 ... 31 steps
+//		between, run for -s steps in all (default 64 M), interleaved by
+//		envgen_step() into a 256 channel request array, and the steps per
+//		second, the time per step and the arena bytes per generator are
+//		reported.
+//
+//	Build:
+//		gcc -O2 -Ihost -o bench_envgen host/fw.c host/sim.c host/envgen.c
+//			host/bench_envgen.c -lm
+//	Run:
+//		./bench_envgen [-g generators] [-s steps]
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "msp430g2211.h"
+#include "sim.h"
+#include "envgen.h"
+
+#define ARENA			(4 << 20)	// Bytes, ~100 k generators
+
+extern const unsigned char fwInc[], fwSteps[];
+void calc_CH_0_TO_2(void);		// main.c, not with GEN_SHOW
+void calc_CH_3_TO_5(void);
+void calc_CH_6_TO_7(void);
+void calc_CH_8_TO_9(void);
+
+static unsigned char arena[ARENA];
+
+//------------------------------------------------------------------------------
+// The shipped envelopes: channel role in its group, phase it starts in
+//------------------------------------------------------------------------------
+typedef struct {
+	envgen g;
+	int level, inc, steps, phases;
+	int rise, fall;				// Phase of the fade up and down
+	int p, i;
+} fade;
+
+static const struct {
+	int phases, first;			// Per group
+	int rise[3], fall[3];		// Per channel of the group
+} shipped[4] = {
+	{ 6, 0, { 4, 0, 2 }, { 1, 3, 5 } }, { 6, 3, { 4, 0, 2 }, { 1, 3, 5 } },
+	{ 4, 0, { 1, 0 }, { 3, 2 } }, { 4, 2, { 1, 0 }, { 3, 2 } } };
+static const int groupOf[10] = { 0, 0, 0, 1, 1, 1, 2, 2, 3, 3 };
+static const int firstCh[4] = { 0, 3, 6, 8 };
+
+static int fade_run(envgen *g) {
+	fade *f = (fade *)g;
+
+	ENVGEN_BEGIN(g);
+	for (;;) {
+		for (f->i = 0; f->i < f->steps; ++f->i) {
+			if (f->p == f->rise)
+				f->level += f->inc;
+			else if (f->p == f->fall)
+				f->level -= f->inc;
+			ENVGEN_YIELD(g, f->level);
+		}
+		f->p = (f->p + 1) % f->phases;
+	}
+	ENVGEN_END(g);
+}
+
+static int check(void) {
+//	Generators against calc_CH_*(), 0 = the same on every step
+	unsigned char mine[10];
+	envgen_sched s;
+	fade *f;
+	int n, k, gr, t, cycle;
+
+	envgen_init(&s, arena, ARENA);
+	for (n = 0; n < fwChannels; ++n) {
+		gr = groupOf[n];
+		k = n - firstCh[gr];
+		f = envgen_new(&s, sizeof(fade), fade_run, n);
+		f->level = mine[n] = req[n];
+		f->inc = fwInc[n];
+		f->steps = fwSteps[n];
+		f->phases = shipped[gr].phases;
+		f->p = shipped[gr].first;
+		f->rise = shipped[gr].rise[k];
+		f->fall = shipped[gr].fall[k];
+	}
+	for (n = 0, cycle = 0; n < fwChannels; ++n)
+		if (shipped[groupOf[n]].phases * fwSteps[n] > cycle)
+			cycle = shipped[groupOf[n]].phases * fwSteps[n];
+	for (t = 0; t < 2 * cycle; ++t) {
+		calc_CH_0_TO_2();
+		calc_CH_3_TO_5();
+		calc_CH_6_TO_7();
+		calc_CH_8_TO_9();
+		envgen_step(&s, mine);
+		for (n = 0; n < fwChannels; ++n)
+			if (mine[n] != req[n]) {
+				printf("step %d channel %d: generator %u, calc_CH_* %u\n", t, n,
+						mine[n], req[n]);
+				return 1;
+			}
+	}
+	printf("shipped envelopes as generators: %d steps, same req[] as "
+			"calc_CH_*()\n", 2 * cycle);
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// Random shows for the benchmark
+//------------------------------------------------------------------------------
+typedef struct {
+	envgen g;
+	unsigned long rnd;
+	int from, to, n, i;
+} show;
+
+static int rand_next(unsigned long *r) {
+	*r = *r * 1103515245 + 12345;
+	return *r >> 16 & 0x7FFF;
+}
+
+static int show_run(envgen *g) {
+	show *s = (show *)g;
+
+	ENVGEN_BEGIN(g);
+	for (;;) {
+		s->to = rand_next(&s->rnd) & 0xFF;
+		s->n = 1 + (rand_next(&s->rnd) & 63);
+		for (s->i = 1; s->i <= s->n; ++s->i)
+			ENVGEN_YIELD(g, s->from + (s->to - s->from) * s->i / s->n);
+		s->from = s->to;
+		for (s->i = rand_next(&s->rnd) & 31; s->i; --s->i)
+			ENVGEN_YIELD(g, s->from);
+	}
+	ENVGEN_END(g);
+}
+
+int main(int argc, char **argv) {
+	unsigned long steps = 64UL << 20, lit = 0;
+	unsigned char out[256];
+	struct timespec t0, t1;
+	envgen_sched s;
+	show *p;
+	double secs;
+	int opt, gens = 4096, i;
+
+	while ((opt = getopt(argc, argv, "g:s:")) != -1) {
+		if (opt == 'g')
+			gens = atoi(optarg);
+		else if (opt == 's')
+			steps = strtoul(optarg, NULL, 0);
+		else {
+			fprintf(stderr, "usage: bench_envgen [-g generators] [-s steps]\n");
+			return 2;
+		}
+	}
+	if (check()) {
+		printf("FAIL\n");
+		return 1;
+	}
+
+	envgen_init(&s, arena, ARENA);
+	for (i = 0; i < gens; ++i) {
+		if (!(p = envgen_new(&s, sizeof(show), show_run, i & 0xFF))) {
+			fprintf(stderr, "bench_envgen: arena full at %d generators\n", i);
+			return 2;
+		}
+		p->rnd = i + 1;
+	}
+	memset(out, 0, sizeof(out));
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	while (s.steps < steps) {
+		envgen_step(&s, out);
+		lit += out[0];			// Keep the result live
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	secs = t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+	printf("%d generators, %zu arena bytes each, %lu steps in %.2f s: "
+			"%.1f M steps/s, %.1f ns/step (%lu)\n", gens, s.used / gens,
+			s.steps, secs, s.steps / secs * 1e-6, secs * 1e9 / s.steps,
+			lit & 0xFF);
+	printf("PASS\n");
+	return 0;
+}
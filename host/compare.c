@@ -0,0 +1,268 @@
+//******************************************************************************
+//	Delta-sigma versus PWM report - both builds through the simulator
+//
+//	Description:
+//		Builds host/sim_compare.c twice, as shipped and with MOD_PWM for the
+//		channel groups of -p (a channel mask of whole groups, default all
+//		ten; PWM of the same average), runs both at once and tabulates, for
+//		each channel and both modulations:
+//			switching	pin edges per second
+//			centroid	mean frequency of the output power, Hz
+//			spread		its standard deviation around the centroid, Hz
+//			flicker		RMS ripple seen by the eye model of sim.c, %
+//			cycles		estimated calc_output_bits() cycles per tick
+//			energy		switching power, uW (sim_compare.c)
+//		all averaged over held levels between 0 and max, plus the busiest
+//		tick of each build. The channels outside -p keep their policy in
+//		both.
+//
+//		Writes <out>.csv, one line per channel and modulation, and
+//		<out>.html, a static page with the same figures side by side and
+//		bars for the ratio of each. Replaces looking at the pins of
+//		main-only-compare-waveforms.c with a scope.
+//
+//	Build:
+//		gcc -O2 -pthread -o compare host/compare.c -lm
+//	Run: (from the repository root)
+//		./compare [-p mask] [-D opts] [-o out]
+//		e.g. ./compare -p 0x300 -o ch89 (PWM on channels 8 and 9 only)
+//******************************************************************************
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define N_CH			16		// Most channels a build reports
+#define N_FIG			6		// Figures per channel
+#define CMD_LEN			512
+#define MOD_LEN			8
+
+static const struct {
+	const char *name;		// MOD_CH_* of main.c
+	unsigned int mask;		// Its channels
+} groups[] = {
+	{ "MOD_CH_0_2", 0x007 }, { "MOD_CH_3_5", 0x038 },
+	{ "MOD_CH_6_7", 0x0C0 }, { "MOD_CH_8_9", 0x300 } };
+#define N_GROUP			(sizeof groups / sizeof groups[0])
+
+enum { DS, PWM, N_BUILD };
+static const char *const buildName[N_BUILD] = { "delta-sigma", "PWM" };
+
+static const struct {
+	const char *name, *csv, *unit;
+	int decimals;
+	int lowBetter;			// 1 = the smaller figure is the better one
+} figs[N_FIG] = {
+	{ "switching", "switch_hz", "Hz", 1, 1 },
+	{ "centroid", "centroid_hz", "Hz", 1, 0 },
+	{ "spread", "spread_hz", "Hz", 1, 0 },
+	{ "flicker", "flicker_pct", "%", 3, 1 },
+	{ "cycles", "cycles_per_tick", "", 0, 1 },
+	{ "energy", "energy_uw", "uW", 3, 1 } };
+
+typedef struct {
+	char opts[CMD_LEN];		// -D of this build
+	double busy;			// Busiest tick, % of its period
+	unsigned long missed;
+	int nCh;				// Channels reported, 0 = build or run failed
+	int max[N_CH];
+	char mod[N_CH][MOD_LEN];	// Policy, simModName of sim.c
+	double fig[N_CH][N_FIG];
+} build;
+
+static build builds[N_BUILD];
+static char dir[] = "/tmp/compare.XXXXXX";
+
+static void *run(void *arg) {
+//------------------------------------------------------------------------------
+// Build and run one sim_compare, parse its lines
+//------------------------------------------------------------------------------
+	build *b = arg;
+	char cmd[2 * CMD_LEN], line[256], *bin;
+	double *f;
+	FILE *p;
+	int n;
+
+	bin = b == &builds[DS] ? "ds" : "pwm";
+	snprintf(cmd, sizeof cmd, "gcc -O2 -Ihost %s -o %s/%s host/fw.c "
+			"host/sim.c host/sim_compare.c -lm 2>/dev/null && %s/%s; "
+			"rm -f %s/%s", b->opts, dir, bin, dir, bin, dir, bin);
+	if (!(p = popen(cmd, "r")))
+		return NULL;
+	if (fgets(line, sizeof line, p) &&
+			sscanf(line, "%lf %lu", &b->busy, &b->missed) == 2)
+		while (b->nCh < N_CH && fgets(line, sizeof line, p)) {
+			f = b->fig[b->nCh];
+			if (sscanf(line, "%d %d %7s %lf %lf %lf %lf %lf %lf", &n,
+					&b->max[b->nCh], b->mod[b->nCh], &f[0], &f[1], &f[2],
+					&f[3], &f[4], &f[5]) != 9 || n != b->nCh)
+				break;
+			++b->nCh;
+		}
+	pclose(p);
+	return NULL;
+}
+
+static void write_csv(FILE *f) {
+	int k, n, i;
+
+	fprintf(f, "channel,modulation,max");
+	for (i = 0; i < N_FIG; ++i)
+		fprintf(f, ",%s", figs[i].csv);
+	fprintf(f, "\n");
+	for (n = 0; n < builds[DS].nCh; ++n)
+		for (k = 0; k < N_BUILD; ++k) {
+			fprintf(f, "%d,%s,%d", n, builds[k].mod[n], builds[k].max[n]);
+			for (i = 0; i < N_FIG; ++i)
+				fprintf(f, ",%.*f", figs[i].decimals, builds[k].fig[n][i]);
+			fprintf(f, "\n");
+		}
+}
+
+static void write_html(FILE *f, unsigned int mask) {
+//------------------------------------------------------------------------------
+// One table, a row per channel and a column pair per figure. The bar under
+// each pair is as long as the ratio of the two on a log scale (full width
+// at 100), green where PWM is better.
+//------------------------------------------------------------------------------
+	double ds, pwm, r, w;
+	const char *m;
+	int n, i;
+
+	fprintf(f, "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\">\n"
+			"<title>Delta-sigma versus PWM</title>\n<style>\n"
+			"body { font-family: sans-serif; margin: 2em; }\n"
+			"table { border-collapse: collapse; }\n"
+			"th, td { border: 1px solid #ccc; padding: 3px 8px; "
+			"text-align: right; }\n"
+			".bar { height: 4px; background: #c33; }\n"
+			".good { background: #3a3; }\n"
+			"</style></head><body>\n<h1>Delta-sigma versus PWM</h1>\n");
+	fprintf(f, "<p>PWM on channels 0x%03X, held levels between 0 and max, "
+			"options: %s</p>\n<ul>\n", mask,
+			*builds[PWM].opts ? builds[PWM].opts : "none");
+	for (i = 0; i < N_BUILD; ++i)
+		fprintf(f, "<li>%s build: busiest tick %.1f %%, %lu missed</li>\n",
+				buildName[i], builds[i].busy, builds[i].missed);
+	fprintf(f, "</ul>\n<table>\n<tr><th rowspan=\"2\">channel</th>"
+			"<th rowspan=\"2\">max</th>");
+	for (i = 0; i < N_FIG; ++i)
+		fprintf(f, "<th colspan=\"2\">%s%s%s%s</th>", figs[i].name,
+				*figs[i].unit ? " (" : "", figs[i].unit,
+				*figs[i].unit ? ")" : "");
+	fprintf(f, "</tr>\n<tr>");
+	for (i = 0; i < N_FIG; ++i)
+		fprintf(f, "<th>DS</th><th>PWM</th>");
+	fprintf(f, "</tr>\n");
+	for (n = 0; n < builds[DS].nCh; ++n) {
+		m = builds[PWM].mod[n];
+		fprintf(f, "<tr><td>%d%s%s%s</td><td>%d</td>", n,
+				strcmp(m, "PWM") ? " (" : "", strcmp(m, "PWM") ? m : "",
+				strcmp(m, "PWM") ? ")" : "", builds[DS].max[n]);
+		for (i = 0; i < N_FIG; ++i) {
+			ds = builds[DS].fig[n][i];
+			pwm = builds[PWM].fig[n][i];
+			r = ds > 0 && pwm > 0 ? pwm / ds : 1;
+			w = fabs(log10(r)) * 50;	// 100 % at 100 or 1/100
+			if (w > 100)
+				w = 100;
+			fprintf(f, "<td>%.*f</td><td>%.*f<div class=\"bar%s\" "
+					"style=\"width: %.0f%%\"></div></td>", figs[i].decimals,
+					ds, figs[i].decimals, pwm,
+					(r < 1) == figs[i].lowBetter ? " good" : "", w);
+		}
+		fprintf(f, "</tr>\n");
+	}
+	fprintf(f, "</table>\n<p>Generated by host/compare.c from "
+			"host/sim_compare.c.</p>\n</body></html>\n");
+}
+
+int main(int argc, char **argv) {
+	unsigned int mask = 0x3FF;
+	const char *opts = "", *out = "compare";
+	char path[CMD_LEN], *d;
+	pthread_t tid[N_BUILD];
+	FILE *f;
+	int opt, k, n, i;
+	unsigned int g;
+
+	while ((opt = getopt(argc, argv, "p:D:o:")) != -1) {
+		if (opt == 'p')
+			mask = strtoul(optarg, NULL, 0);
+		else if (opt == 'D')
+			opts = optarg;
+		else if (opt == 'o')
+			out = optarg;
+		else
+			optind = argc + 1;
+	}
+	if (optind != argc || !mask) {
+		fprintf(stderr, "usage: compare [-p mask] [-D opts] [-o out]\n");
+		return 2;
+	}
+	for (g = 0; g < N_GROUP; ++g)
+		if (mask & groups[g].mask && (mask & groups[g].mask) != groups[g].mask) {
+			fprintf(stderr, "compare: -p 0x%X splits %s (0x%03X), the policy "
+					"is set per group\n", mask, groups[g].name, groups[g].mask);
+			return 2;
+		}
+	if (!mkdtemp(dir)) {
+		perror("compare");
+		return 2;
+	}
+	snprintf(builds[DS].opts, CMD_LEN, "%s", opts);
+	d = builds[PWM].opts;
+	for (g = 0; g < N_GROUP; ++g)
+		if (mask & groups[g].mask)
+			d += sprintf(d, "%s-D%s=MOD_PWM", d != builds[PWM].opts ?
+					" " : "", groups[g].name);
+	snprintf(d, CMD_LEN - (d - builds[PWM].opts), "%s%s", *opts ? " " : "",
+			opts);
+	for (k = 0; k < N_BUILD; ++k)
+		pthread_create(&tid[k], NULL, run, &builds[k]);
+	for (k = 0; k < N_BUILD; ++k)
+		pthread_join(tid[k], NULL);
+	rmdir(dir);
+	for (k = 0; k < N_BUILD; ++k)
+		if (!builds[k].nCh || builds[k].nCh != builds[DS].nCh) {
+			fprintf(stderr, "compare: %s build (%s) failed\n", buildName[k],
+					builds[k].opts);
+			return 1;
+		}
+
+	snprintf(path, sizeof path, "%s.csv", out);
+	if (!(f = fopen(path, "w"))) {
+		perror(path);
+		return 2;
+	}
+	write_csv(f);
+	fclose(f);
+	snprintf(path, sizeof path, "%s.html", out);
+	if (!(f = fopen(path, "w"))) {
+		perror(path);
+		return 2;
+	}
+	write_html(f, mask);
+	fclose(f);
+
+	printf("ch  max ");
+	for (i = 0; i < N_FIG; ++i)
+		printf(" %9.9s DS/PWM", figs[i].name);
+	printf("\n");
+	for (n = 0; n < builds[DS].nCh; ++n) {
+		printf("%2d  %3d ", n, builds[DS].max[n]);
+		for (i = 0; i < N_FIG; ++i)
+			printf(" %8.*f/%-7.*f", figs[i].decimals > 1 ? 2 : figs[i].decimals,
+					builds[DS].fig[n][i],
+					figs[i].decimals > 1 ? 2 : figs[i].decimals,
+					builds[PWM].fig[n][i]);
+		printf("\n");
+	}
+	printf("busiest tick %.1f / %.1f %%, missed %lu / %lu; wrote %s.csv, "
+			"%s.html\n", builds[DS].busy, builds[PWM].busy, builds[DS].missed,
+			builds[PWM].missed, out, out);
+	return 0;
+}
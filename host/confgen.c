@@ -0,0 +1,291 @@
+//******************************************************************************
+//	Configuration generator - MAX, STEPS, LOOP_SPEED and tick from targets
+//
+//	Description:
+//		Solves for the settings at the top of main.c from three targets:
+//			-f Hz	no idle tone below this frequency stronger than -A
+//			-p s	fade time, one envelope ramp from 0 to max, per group
+//					(one value, or four comma separated), within -T
+//			-c %	busiest tick, % of the shortest tick period
+//		and writes them as a header that main.c includes with GEN_CONFIG.
+//
+//		The cost of a tick does not depend on MAX and STEPS, so each
+//		candidate tick is simulated once (sim_sweep.c, with the options of
+//		-D) and dropped if it is over -c or misses ticks. These are the
+//		WDT ticks, 8192 and 32768 cycles, and with -s every multiple of
+//		1024 from 2048 on with SPREAD_TICK, where the busiest tick has to
+//		fit the shortest period, SPREAD_MIN. The same run reports the
+//		largest LOOP_SPEED the firmware allows with the options of -D
+//		(LOOP_SPEED_MAX). The tones come in closed form:
+//		at req/max = p/q (reduced) a first-order modulator repeats every q
+//		ticks, and its harmonic k, at k/q of the tick rate, has amplitude
+//			2 sin(pi k/q) / (q sin(pi j/q)),	j = k/p mod q
+//		(the same figures as the DFT of host/tones.c). The envelope of a
+//		group visits k * max/STEPS, k = 0 ... STEPS, the levels of max =
+//		STEPS, so its tones depend on STEPS only; -a checks every level of
+//		max instead, for hosts that set any req.
+//
+//		A fade takes STEPS * 2**LOOP_SPEED ticks. For each tick and
+//		LOOP_SPEED every group takes the most steps that meet the tone
+//		target within the fade tolerance, and max is the largest multiple
+//		of them up to 255 (with -a, that still meets it). The solution with
+//		the most steps in its coarsest group wins (smoothest fades), then
+//		the lowest CPU use; it is simulated again in full and reported.
+//
+//	Build:
+//		gcc -O2 -o confgen host/confgen.c -lm
+//	Run: (from the repository root)
+//		./confgen [-f Hz] [-A floor] [-p s[,s,s,s]] [-T tol] [-c %] [-a] [-s]
+//			[-D opts] [-o header]
+//		defaults: 100 Hz, 0.005, 3.3 s, 0.1, 50 %, config.h
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SMCLK			16e6	// As SIM_SMCLK
+#define GROUPS			4
+#define MAX_RES			255		// req[] is a byte
+#define N_TICKS			34		// 8192, 32768, then spread 2048 ... 32768
+
+static const char *const groupName[GROUPS] = { "0_2", "3_5", "6_7", "8_9" };
+
+static double minHz = 100, floorAmp = 0.005;
+static char simOpts[256] = "";
+
+static int inverse(int p, int q) {
+//	p**-1 mod q, p and q coprime
+	int k;
+
+	for (k = 1; k < q; ++k)
+		if (p * k % q == 1)
+			return k;
+	return 1;
+}
+
+static int gcd(int a, int b) {
+	int t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static int quiet(int res, double tickHz) {
+//------------------------------------------------------------------------------
+// 1 = no level of this resolution has a tone below minHz over floorAmp
+//------------------------------------------------------------------------------
+	int r, p, q, k, j, g, pInv;
+	double amp;
+
+	for (r = 1; r < res; ++r) {
+		g = gcd(r, res);
+		p = r / g;
+		q = res / g;
+		pInv = inverse(p, q);
+		for (k = 1; 2 * k <= q && k * tickHz / q < minHz; ++k) {
+			j = k * pInv % q;
+			amp = (2 * k == q ? 1 : 2) * sin(M_PI * k / q) /
+					(q * sin(M_PI * j / q));
+			if (amp > floorAmp)
+				return 0;
+		}
+	}
+	return 1;
+}
+
+static int simulate(int tick, int spread, const char *def, double *busy,
+		unsigned long *miss, int *loopMax) {
+//	sim_sweep.c with these -D, 1 = ran
+	char cmd[1024], line[256];
+	double flick, edges, uw, jump, rate;
+	FILE *p;
+	int ok = 0;
+
+	snprintf(cmd, sizeof cmd, "gcc -O1 -Ihost -DTICK_CYCLES=%d%s %s %s "
+			"-o confgen.sim host/fw.c host/sim.c host/sim_sweep.c -lm "
+			"2>/dev/null && ./confgen.sim; rm -f confgen.sim", tick,
+			spread ? " -DSPREAD_TICK=1" : "", def, simOpts);
+	if ((p = popen(cmd, "r"))) {
+		ok = fgets(line, sizeof line, p) && sscanf(line, "%lf %lu %lf %lf "
+				"%lf %lf %lf %d", busy, miss, &flick, &edges, &uw, &jump,
+				&rate, loopMax) == 8;
+		pclose(p);
+	}
+	return ok;
+}
+
+int main(int argc, char **argv) {
+	double fade[GROUPS] = { 3.3, 3.3, 3.3, 3.3 }, tol = 0.1, cpu = 50;
+	double busy[N_TICKS], tickHz, t, err, bestErr = 0, bestBusy = 0;
+	unsigned long miss;
+	int all = 0, spread = 0, nTicks = 0, ticks[N_TICKS], opt, i, g, l, s, m;
+	int steps[GROUPS], maxV[GROUPS], best[GROUPS], bestMax[GROUPS];
+	int bestTick = 0, bestLoop = -1, bestMin = 0, minSteps, n;
+	int loopMax[N_TICKS];
+	const char *path = "config.h";
+	char def[512], *d;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "f:A:p:T:c:asD:o:")) != -1) {
+		if (opt == 'f')
+			minHz = atof(optarg);
+		else if (opt == 'A')
+			floorAmp = atof(optarg);
+		else if (opt == 'p') {
+			for (g = 0, d = optarg; g < GROUPS && *d; ++g) {
+				fade[g] = strtod(d, &d);
+				if (*d == ',')
+					++d;
+			}
+			for (; g < GROUPS && g > 0; ++g)
+				fade[g] = fade[g - 1];
+		}
+		else if (opt == 'T')
+			tol = atof(optarg);
+		else if (opt == 'c')
+			cpu = atof(optarg);
+		else if (opt == 'a')
+			all = 1;
+		else if (opt == 's')
+			spread = 1;
+		else if (opt == 'D')
+			snprintf(simOpts, sizeof simOpts, "%s", optarg);
+		else if (opt == 'o')
+			path = optarg;
+		else
+			optind = argc + 1;
+	}
+	if (optind != argc || minHz < 0 || tol <= 0) {
+		fprintf(stderr, "usage: confgen [-f Hz] [-A floor] [-p s[,s,s,s]] "
+				"[-T tol] [-c %%] [-a] [-s] [-D opts] [-o header]\n");
+		return 2;
+	}
+
+	ticks[nTicks++] = 8192;			// WDT, then Timer_A with SPREAD_TICK
+	ticks[nTicks++] = 32768;
+	for (i = 2048; spread && i <= 32768; i += 1024)
+		ticks[nTicks++] = i;
+	for (i = 0; i < nTicks; ++i) {
+		busy[i] = -1;
+		if (simulate(ticks[i], i >= 2, "", &busy[i], &miss, &loopMax[i]) &&
+				(miss || busy[i] > cpu))
+			busy[i] = -1;
+	}
+
+	for (i = 0; i < nTicks; ++i) {
+		if (busy[i] < 0)
+			continue;
+		tickHz = SMCLK / ticks[i];
+		for (l = 0; l <= loopMax[i]; ++l) {
+			minSteps = MAX_RES;
+			err = 0;
+			for (g = 0; g < GROUPS; ++g) {
+				steps[g] = 0;
+				for (s = MAX_RES; s >= 1 && !steps[g]; --s) {
+					t = (double)s * (1 << l) / tickHz;
+					if (fabs(t - fade[g]) <= tol * fade[g] && quiet(s, tickHz))
+						steps[g] = s;
+				}
+				if (!steps[g])
+					break;
+				for (m = MAX_RES / steps[g] * steps[g]; m > steps[g] && all &&
+						!quiet(m, tickHz); m -= steps[g])
+					;
+				maxV[g] = m;
+				if (steps[g] < minSteps)
+					minSteps = steps[g];
+				err += fabs(steps[g] * (1 << l) / tickHz - fade[g]) / fade[g];
+			}
+			if (g < GROUPS)
+				continue;
+			if (bestLoop < 0 || minSteps > bestMin || (minSteps == bestMin &&
+					(busy[i] < bestBusy || (busy[i] == bestBusy &&
+					err < bestErr)))) {
+				bestTick = i;
+				bestLoop = l;
+				bestMin = minSteps;
+				bestBusy = busy[i];
+				bestErr = err;
+				memcpy(best, steps, sizeof best);
+				memcpy(bestMax, maxV, sizeof bestMax);
+			}
+		}
+	}
+
+	printf("targets: no tone below %.0f Hz over %.2f %% (%s), fades", minHz,
+			100 * floorAmp, all ? "all levels" : "envelope levels");
+	for (g = 0; g < GROUPS; ++g)
+		printf(" %.2f", fade[g]);
+	printf(" s +-%.0f %%, busiest tick <= %.0f %%\n", 100 * tol, cpu);
+	for (i = n = 0; i < nTicks; ++i)
+		n += busy[i] >= 0;
+	printf("%d of %d ticks within the CPU target\n", n, nTicks);
+	if (bestLoop < 0) {
+		printf("no configuration meets the targets\n");
+		return 1;
+	}
+
+	n = snprintf(def, sizeof def, "-DLOOP_SPEED=%d", bestLoop);
+	for (g = 0; g < GROUPS; ++g)
+		n += snprintf(def + n, sizeof def - n, " -DMAX_CH_%s=%d "
+				"-DSTEPS_CH_%s=%d", groupName[g], bestMax[g], groupName[g],
+				best[g]);
+	if (!simulate(ticks[bestTick], bestTick >= 2, def, &busy[bestTick],
+			&miss, &n) || miss) {
+		printf("simulation of the solution failed\n");
+		return 1;
+	}
+	tickHz = SMCLK / ticks[bestTick];
+
+	if (!(f = fopen(path, "w"))) {
+		perror("confgen");
+		return 2;
+	}
+	fprintf(f, "//*********************************************************"
+			"*********************\n");
+	fprintf(f, "//\tSettings of main.c for GEN_CONFIG, generated by "
+			"host/confgen.c,\n//\tdo not edit. Options:");
+	for (i = 1; i < argc; ++i)
+		fprintf(f, " %s", argv[i]);
+	fprintf(f, "\n//\n");
+	fprintf(f, "//\tTargets: no tone below %.0f Hz over %.2f %% (%s),\n", minHz,
+			100 * floorAmp, all ? "all levels" : "envelope levels");
+	fprintf(f, "//\t\tfades");
+	for (g = 0; g < GROUPS; ++g)
+		fprintf(f, " %.2f", fade[g]);
+	fprintf(f, " s +-%.0f %%, busiest tick <= %.0f %%\n", 100 * tol, cpu);
+	fprintf(f, "//\tResult: tick %.1f Hz, busiest tick %.1f %% of the shortest "
+			"(simulated),\n"
+			"//\t\tfades", tickHz, busy[bestTick]);
+	for (g = 0; g < GROUPS; ++g)
+		fprintf(f, " %.2f", best[g] * (1 << bestLoop) / tickHz);
+	fprintf(f, " s\n");
+	fprintf(f, "//*********************************************************"
+			"*********************\n\n");
+	fprintf(f, "#ifndef CONFIG_H\n#define CONFIG_H\n\n");
+	fprintf(f, "#define TICK_CYCLES\t\t%d\n", ticks[bestTick]);
+	if (bestTick >= 2)
+		fprintf(f, "#define SPREAD_TICK\t\t1\n");
+	fprintf(f, "#define LOOP_SPEED\t\t%d\n\n", bestLoop);
+	for (g = 0; g < GROUPS; ++g)
+		fprintf(f, "#define MAX_CH_%s\t\t%d\n#define STEPS_CH_%s\t%d\n",
+				groupName[g], bestMax[g], groupName[g], best[g]);
+	fprintf(f, "\n#endif\n");
+	fclose(f);
+
+	printf("tick %d cycles (%.1f Hz%s), LOOP_SPEED %d, busiest tick %.1f %%\n",
+			ticks[bestTick], tickHz, bestTick >= 2 ? ", SPREAD_TICK" : "",
+			bestLoop, busy[bestTick]);
+	for (g = 0; g < GROUPS; ++g)
+		printf("group %s: MAX %3d, STEPS %3d, fade %.2f s\n", groupName[g],
+				bestMax[g], best[g], best[g] * (1 << bestLoop) / tickHz);
+	printf("%s written\n", path);
+	return 0;
+}
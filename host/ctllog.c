@@ -0,0 +1,99 @@
+//******************************************************************************
+//	Control traffic log - writer and reader, see ctllog.h
+//******************************************************************************
+
+#include <string.h>
+#include "ctllog.h"
+
+static const unsigned char magic[4] = { 'C', 'T', 'L', '1' };
+
+int ctllog_create(ctllog *log, const char *path, unsigned long baud) {
+//------------------------------------------------------------------------------
+// New log for a link at baud; 0 if the file cannot be written
+//------------------------------------------------------------------------------
+	int i;
+
+	log->f = fopen(path, "wb");
+	log->baud = baud;
+	log->tick = 0;
+	if (!log->f)
+		return 0;
+	fwrite(magic, 1, 4, log->f);
+	for (i = 0; i < 4; ++i)
+		fputc(baud >> 8 * i, log->f);
+	return 1;
+}
+
+int ctllog_open(ctllog *log, const char *path) {
+//------------------------------------------------------------------------------
+// Existing log for ctllog_read(); 0 if missing or not a log
+//------------------------------------------------------------------------------
+	unsigned char h[8];
+	int i;
+
+	log->f = fopen(path, "rb");
+	log->tick = 0;
+	if (!log->f)
+		return 0;
+	if (fread(h, 1, 8, log->f) != 8 || memcmp(h, magic, 4)) {
+		fclose(log->f);
+		log->f = NULL;
+		return 0;
+	}
+	for (i = 3, log->baud = 0; i >= 0; --i)
+		log->baud = log->baud << 8 | h[4 + i];
+	return 1;
+}
+
+void ctllog_write(ctllog *log, sim_time t, const unsigned char *p, int len) {
+//------------------------------------------------------------------------------
+// Record len bytes that start on the wire at SMCLK cycle t
+//------------------------------------------------------------------------------
+	unsigned long tick = (unsigned long)(t / SIM_TICK);
+	unsigned long d = tick - log->tick;
+	unsigned int cyc = (unsigned int)(t % SIM_TICK);
+
+	if (len > CTLLOG_MAX) {			// Split, the rest starts once the first
+		ctllog_write(log, t, p, CTLLOG_MAX);	//   piece is on the wire (8N1)
+		ctllog_write(log, t + (sim_time)(CTLLOG_MAX * 10.0 * SIM_SMCLK /
+				log->baud), p + CTLLOG_MAX, len - CTLLOG_MAX);
+		return;
+	}
+	for (; d >= 0x80; d >>= 7)
+		fputc(d | 0x80, log->f);
+	fputc(d, log->f);
+	fputc(cyc & 0xFF, log->f);
+	fputc(cyc >> 8, log->f);
+	fputc(len, log->f);
+	fwrite(p, 1, len, log->f);
+	log->tick = tick;
+}
+
+int ctllog_read(ctllog *log, sim_time *t, unsigned char *p) {
+//------------------------------------------------------------------------------
+// Next record: start cycle and bytes; returns the length, 0 at the end
+//------------------------------------------------------------------------------
+	unsigned long d = 0;
+	int c, shift = 0, lo, hi, len;
+
+	do {
+		if ((c = fgetc(log->f)) == EOF)
+			return 0;
+		d |= (unsigned long)(c & 0x7F) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	lo = fgetc(log->f);
+	hi = fgetc(log->f);
+	len = fgetc(log->f);
+	if (len <= 0 || hi == EOF || (int)fread(p, 1, len, log->f) != len)
+		return 0;					// Truncated, e.g. lightd killed
+	log->tick += d;
+	*t = (sim_time)log->tick * SIM_TICK + (lo | hi << 8);
+	return len;
+}
+
+void ctllog_close(ctllog *log) {
+	if (log->f)
+		fclose(log->f);
+	log->f = NULL;
+}
@@ -0,0 +1,35 @@
+//******************************************************************************
+//	Control traffic log - bytes sent to the board with their tick times
+//
+//	Description:
+//		lightd -w appends every write to the device here; sim_replay feeds a
+//		log back into the simulator. The file is a header
+//			'C', 'T', 'L', '1', baud (4 bytes, little endian)
+//		followed by one record per write
+//			tick delta (varint), cycle in the tick (2 bytes), length, bytes
+//		with the tick counted in WDT ticks since reset, delta to the record
+//		before, in 7 bit groups lowest first, bit 7 set while more follow.
+//		A frame update costs 4 bytes plus the frame.
+//******************************************************************************
+
+#ifndef HOST_CTLLOG_H
+#define HOST_CTLLOG_H
+
+#include <stdio.h>
+#include "sim.h"
+
+#define CTLLOG_MAX		255		// Longest record
+
+typedef struct {
+	FILE *f;
+	unsigned long baud;
+	unsigned long tick;			// Tick of the last record
+} ctllog;
+
+int ctllog_create(ctllog *log, const char *path, unsigned long baud);
+int ctllog_open(ctllog *log, const char *path);
+void ctllog_write(ctllog *log, sim_time t, const unsigned char *p, int len);
+int ctllog_read(ctllog *log, sim_time *t, unsigned char *p);	// 0 = end
+void ctllog_close(ctllog *log);
+
+#endif
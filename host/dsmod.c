@@ -0,0 +1,171 @@
+//******************************************************************************
+//	dsmod - C ABI over engine.h, see dsmod.h
+//
+//	Description:
+//		Built with -fvisibility=hidden, so libdsmod.so exports the dsmod_*
+//		functions alone, not the firmware, simulator or engine symbols.
+//******************************************************************************
+
+#define DSMOD_BUILD
+#include <stdlib.h>
+#include "dsmod.h"
+#include "engine.h"
+
+#if ENGINE_CH > DSMOD_CH
+#error "engine.h has more channels than dsmod_stats has room for"
+#endif
+
+typedef char dsmod_frame_size[sizeof(unsigned int) == sizeof(uint32_t) ? 1 : -1];
+
+#define POLICY_PDM		4		// MOD_PDM and MOD_BAM of main.c
+#define POLICY_BAM		5
+
+extern const unsigned char fwMod[];	// fw.c, through engine.c
+
+struct dsmod {
+	engine e;
+	uint64_t calls;
+	uint64_t lit[DSMOD_CH];
+	unsigned char owned;		// From dsmod_new()
+};
+
+static int max_ok(uint32_t ch, unsigned int m) {
+//	MOD_PDM and MOD_BAM count bits of max, see MOD_4() and MOD_5() of main.c
+	if (!m)
+		return 0;
+	if (fwMod[ch] == POLICY_PDM || fwMod[ch] == POLICY_BAM)
+		return !(m & (m + 1));
+	return 1;
+}
+
+uint32_t dsmod_abi(void) {
+	return DSMOD_ABI;
+}
+
+uint32_t dsmod_channels(void) {
+	return engineChannels;
+}
+
+int dsmod_policy(uint32_t ch) {
+	return ch < engineChannels ? fwMod[ch] : DSMOD_ERANGE;
+}
+
+size_t dsmod_size(void) {
+	return sizeof(dsmod);
+}
+
+dsmod *dsmod_init(void *mem, size_t size) {
+	dsmod *d = mem;
+
+	if (!d || size < sizeof(dsmod) || (uintptr_t)mem % _Alignof(dsmod))
+		return NULL;
+	d->owned = 0;
+	dsmod_reset(d);
+	return d;
+}
+
+dsmod *dsmod_new(void) {
+	dsmod *d = dsmod_init(malloc(sizeof(dsmod)), sizeof(dsmod));
+
+	if (d)
+		d->owned = 1;
+	return d;
+}
+
+void dsmod_free(dsmod *d) {
+	if (d && d->owned)
+		free(d);
+}
+
+int dsmod_reset(dsmod *d) {
+	int n;
+
+	if (!d)
+		return DSMOD_EINVAL;
+	engine_init(&d->e);
+	d->calls = 0;
+	for (n = 0; n < DSMOD_CH; ++n)
+		d->lit[n] = 0;
+	return DSMOD_OK;
+}
+
+int dsmod_set_requests(dsmod *d, uint32_t first, const uint8_t *req,
+		uint32_t count) {
+	uint32_t n;
+
+	if (!d || (count && !req))
+		return DSMOD_EINVAL;
+	if (first > engineChannels || count > engineChannels - first)
+		return DSMOD_ERANGE;
+	for (n = 0; n < count; ++n)
+		d->e.req[first + n] = req[n] > d->e.max[first + n] ?
+				d->e.max[first + n] : req[n];
+	return DSMOD_OK;
+}
+
+int dsmod_set_max(dsmod *d, uint32_t first, const uint8_t *max,
+		uint32_t count) {
+//------------------------------------------------------------------------------
+// All or nothing: no max is set unless every one is valid. Requests above
+// their new max go down to it.
+//------------------------------------------------------------------------------
+	uint32_t n, ch;
+
+	if (!d || (count && !max))
+		return DSMOD_EINVAL;
+	if (first > engineChannels || count > engineChannels - first)
+		return DSMOD_ERANGE;
+	for (n = 0; n < count; ++n)
+		if (!max_ok(first + n, max[n]))
+			return DSMOD_EMAX;
+	for (n = 0; n < count; ++n) {
+		ch = first + n;
+		d->e.max[ch] = max[n];
+		if (d->e.req[ch] > max[n])
+			d->e.req[ch] = max[n];
+	}
+	return DSMOD_OK;
+}
+
+int dsmod_generate(dsmod *d, uint32_t *frames, size_t count) {
+//------------------------------------------------------------------------------
+// count frames into frames[], counted per channel one channel at a time so
+// the counting loop stays a shift, mask and add the compiler can vectorize
+//------------------------------------------------------------------------------
+	uint64_t c;
+	size_t i;
+	int n;
+
+	if (!d || (count && !frames))
+		return DSMOD_EINVAL;
+	engine_generate(&d->e, (unsigned int *)frames, count);
+	for (n = 0; n < engineChannels; ++n) {
+		for (c = 0, i = 0; i < count; ++i)
+			c += frames[i] >> n & 1;
+		d->lit[n] += c;
+	}
+	++d->calls;
+	return DSMOD_OK;
+}
+
+int dsmod_get_stats(const dsmod *d, dsmod_stats *s) {
+//------------------------------------------------------------------------------
+// Fills s up to s->size, so a caller built against an older, shorter
+// dsmod_stats gets the fields it knows
+//------------------------------------------------------------------------------
+	dsmod_stats t;
+	size_t k;
+	int n;
+
+	if (!d || !s || s->size < offsetof(dsmod_stats, ticks))
+		return DSMOD_EINVAL;
+	t.size = s->size < sizeof(t) ? s->size : sizeof(t);
+	t.channels = engineChannels;
+	t.ticks = d->e.ticks;
+	t.calls = d->calls;
+	for (n = 0; n < DSMOD_CH; ++n)
+		t.lit[n] = d->lit[n];
+	for (k = 0; k < t.size; ++k)
+		((unsigned char *)s)[k] = ((unsigned char *)&t)[k];
+	return DSMOD_OK;
+}
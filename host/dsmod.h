@@ -0,0 +1,82 @@
+//******************************************************************************
+//	dsmod - the modulator engine as a shared library with a C ABI
+//
+//	Description:
+//		libdsmod.so wraps engine.h for programs in other languages
+//		(lighting consoles, test rigs): plain functions over an opaque
+//		handle and fixed-width types only, so callers bind it with any
+//		FFI, and the layout of engine.h can change without breaking them.
+//		DSMOD_ABI goes up when a function changes; dsmod_abi() is the
+//		value the library was built with.
+//
+//		An instance is dsmod_size() bytes, either in memory the caller
+//		gives to dsmod_init() or from one malloc() in dsmod_new(). After
+//		that no call allocates. Instances share nothing: each may be used
+//		from its own thread without locks, but one instance from two
+//		threads at once needs the caller's lock.
+//
+//		Functions return DSMOD_OK or a negative DSMOD_E*. Requests above
+//		max are set to max, as the firmware does for the host link.
+//
+//	Build:
+//		gcc -O2 -fPIC -fvisibility=hidden -shared -Ihost -o libdsmod.so
+//			host/engine.c host/sim.c host/dsmod.c -lm
+//		plus the -D options of the firmware build it should match
+//******************************************************************************
+
+#ifndef HOST_DSMOD_H
+#define HOST_DSMOD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__) && defined(DSMOD_BUILD)	// Set by dsmod.c
+#define DSMOD_API		__attribute__((visibility("default")))
+#else
+#define DSMOD_API
+#endif
+
+#define DSMOD_ABI		1
+#define DSMOD_CH		16		// Room in dsmod_stats, channels are fewer
+
+#define DSMOD_OK		0
+#define DSMOD_EINVAL	-1		// No instance, buffer or too little memory
+#define DSMOD_ERANGE	-2		// Channel beyond dsmod_channels()
+#define DSMOD_EMAX		-3		// max 0, or not 2**B - 1 for MOD_PDM/MOD_BAM
+
+typedef struct dsmod dsmod;
+
+typedef struct {
+	uint32_t size;				// sizeof(dsmod_stats) of the caller, set first
+	uint32_t channels;
+	uint64_t ticks;				// Frames since init or reset
+	uint64_t calls;				// dsmod_generate() calls since then
+	uint64_t lit[DSMOD_CH];		// Frames each channel was lit in
+} dsmod_stats;
+
+DSMOD_API uint32_t dsmod_abi(void);
+DSMOD_API uint32_t dsmod_channels(void);	// N_CH of the firmware build
+DSMOD_API int dsmod_policy(uint32_t ch);	// MOD_DS1 ... MOD_BAM of main.c
+
+DSMOD_API size_t dsmod_size(void);
+DSMOD_API dsmod *dsmod_init(void *mem, size_t size);	// NULL if too small
+DSMOD_API dsmod *dsmod_new(void);	// dsmod_init() of one malloc()
+DSMOD_API void dsmod_free(dsmod *d);	// Only for dsmod_new()
+DSMOD_API int dsmod_reset(dsmod *d);	// Modulators and stats as after init
+
+DSMOD_API int dsmod_set_requests(dsmod *d, uint32_t first, const uint8_t *req,
+		uint32_t count);
+DSMOD_API int dsmod_set_max(dsmod *d, uint32_t first, const uint8_t *max,
+		uint32_t count);
+DSMOD_API int dsmod_generate(dsmod *d, uint32_t *frames, size_t count);
+DSMOD_API int dsmod_get_stats(const dsmod *d, dsmod_stats *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+//******************************************************************************
+//	Host modulator engine - see engine.h
+//
+//	Description:
+//		Compiled instead of fw.c, which it includes: the engine uses the
+//		policy macros of main.c (MOD_GROUP() and MOD_1 ... MOD_5) on locals
+//		of the same names as the firmware globals, so it runs the code of
+//		calc_output_bits() for this build, -D options included.
+//******************************************************************************
+
+#include <string.h>
+#include "fw.c"
+#include "engine.h"
+
+#if N_CH > ENGINE_CH
+#error "main.c has more channels than engine.h has room for"
+#endif
+#if MOD_USED(MOD_DS2) && NTF_ORDER > ENGINE_ORDER
+#error "ntf.h has a longer error history than engine.h has room for"
+#endif
+
+#define FRAME_MASK		((1U << N_CH) - 1)
+
+const unsigned char engineChannels = N_CH;
+
+static engine reset;			// The modulators of main.c before the first tick
+
+__attribute__((constructor)) static void engine_reset(void) {
+//	Copy of the initialized globals, before engine_step() touches them
+	int n;
+
+	memset(&reset, 0, sizeof(reset));
+	for (n = 0; n < N_CH; ++n) {
+		reset.max[n] = max[n];
+		reset.req[n] = req[n];
+#if !MOD_ALL(MOD_DS2)
+		reset.sum[n] = sum[n];
+#endif
+#if MOD_USED(MOD_DS2)
+		memcpy(reset.ntfErr[n], ntfErr[n], sizeof(ntfErr[n]));
+#endif
+	}
+#if DITHER
+	reset.rnd = ditherRnd;
+#endif
+}
+
+void engine_init(engine *e) {
+	*e = reset;
+}
+
+void engine_generate(engine *eng, unsigned int *frames, unsigned long count) {
+//------------------------------------------------------------------------------
+// count frames into frames[]. The names of the firmware globals are locals
+// here, so the policy macros work on copies the compiler can keep in
+// registers for the whole block; back into *eng at the end.
+//------------------------------------------------------------------------------
+	unsigned int max[N_CH];
+	unsigned char req[N_CH];
+	unsigned int outBits = 0;
+	unsigned long i;
+	unsigned int m;
+	int n;
+#if !MOD_ALL(MOD_DS2)
+	unsigned int sum[N_CH];
+#endif
+#if MOD_USED(MOD_DS2)
+	int ntfErr[N_CH][NTF_ORDER];
+	int v, r, k;
+	int *e;
+#endif
+#if DITHER
+	unsigned int rnd = eng->rnd;
+#endif
+#if MOD_USED(MOD_PDM)
+	unsigned int b;
+#endif
+#if MOD_USED(MOD_BAM)
+	unsigned int p, w;
+#endif
+
+	for (n = 0; n < N_CH; ++n) {
+		max[n] = eng->max[n];
+		req[n] = eng->req[n];
+#if !MOD_ALL(MOD_DS2)
+		sum[n] = eng->sum[n];
+#endif
+#if MOD_USED(MOD_DS2)
+		memcpy(ntfErr[n], eng->ntfErr[n], sizeof(ntfErr[n]));
+#endif
+	}
+	for (i = 0; i < count; ++i) {
+		MOD_GROUP(MOD_CH_8_9, 8, 9);	// As calc_output_bits()
+		MOD_GROUP(MOD_CH_6_7, 6, 7);
+		MOD_GROUP(MOD_CH_3_5, 3, 5);
+		MOD_GROUP(MOD_CH_0_2, 0, 2);
+		frames[i] = outBits & FRAME_MASK;
+	}
+	for (n = 0; n < N_CH; ++n) {
+#if !MOD_ALL(MOD_DS2)
+		eng->sum[n] = sum[n];
+#endif
+#if MOD_USED(MOD_DS2)
+		memcpy(eng->ntfErr[n], ntfErr[n], sizeof(ntfErr[n]));
+#endif
+	}
+#if DITHER
+	eng->rnd = rnd;
+#endif
+	eng->ticks += count;
+}
+
+unsigned int engine_step(engine *eng) {
+//------------------------------------------------------------------------------
+// One frame through calc_output_bits() itself: *eng into the firmware
+// globals, one call, and back
+//------------------------------------------------------------------------------
+	int n;
+
+	for (n = 0; n < N_CH; ++n) {
+		max[n] = eng->max[n];
+		req[n] = eng->req[n];
+#if !MOD_ALL(MOD_DS2)
+		sum[n] = eng->sum[n];
+#endif
+#if MOD_USED(MOD_DS2)
+		memcpy(ntfErr[n], eng->ntfErr[n], sizeof(ntfErr[n]));
+#endif
+	}
+#if DITHER
+	ditherRnd = eng->rnd;
+#endif
+	calc_output_bits();
+	for (n = 0; n < N_CH; ++n) {
+#if !MOD_ALL(MOD_DS2)
+		eng->sum[n] = sum[n];
+#endif
+#if MOD_USED(MOD_DS2)
+		memcpy(eng->ntfErr[n], ntfErr[n], sizeof(ntfErr[n]));
+#endif
+	}
+#if DITHER
+	eng->rnd = ditherRnd;
+#endif
+	++eng->ticks;
+	return outBits & FRAME_MASK;
+}
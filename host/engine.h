@@ -0,0 +1,47 @@
+//******************************************************************************
+//	Host modulator engine - blocks of frames from the firmware's modulators
+//
+//	Description:
+//		An engine is the state of the modulators of main.c (max[], req[],
+//		the integrators or error histories, the dither LFSR) in memory the
+//		caller owns. engine_generate() runs calc_output_bits() of this
+//		build for a whole block of ticks and writes one frame per tick,
+//		bit n = channel n lit, into the caller's buffer: the state is
+//		loaded into locals once per block, the policy steps of each group
+//		are inlined and nothing is allocated, so the work per tick is the
+//		modulators alone. engine_step() is the same tick through the
+//		firmware function itself, for comparison (see bench_engine.c).
+//
+//		Frames are the output of calc_output_bits(), one per main loop
+//		pass; what SWITCH_LIMIT, BLANKING and the pins make of them, and
+//		the envelopes, need the simulator. The caller sets req[] and max[]
+//		between blocks, as a host does over the link (0 <= req <= max; a
+//		new max for MOD_PDM and MOD_BAM has to be 2**B - 1 too).
+//
+//		Engines are independent: any number may run in parallel threads,
+//		one thread per engine, except engine_step(), which goes through
+//		the firmware globals.
+//******************************************************************************
+
+#ifndef HOST_ENGINE_H
+#define HOST_ENGINE_H
+
+#define ENGINE_CH		16		// Most channels, N_CH of main.c is 10
+#define ENGINE_ORDER	4		// Longest error history, NTF_ORDER of ntf.h
+
+typedef struct {
+	unsigned int max[ENGINE_CH];	// As main.c, 0 ... 255
+	unsigned char req[ENGINE_CH];
+	unsigned int sum[ENGINE_CH];	// Integrators or period counters
+	int ntfErr[ENGINE_CH][ENGINE_ORDER];	// MOD_DS2 error histories
+	unsigned int rnd;			// Dither LFSR
+	unsigned long ticks;		// Frames generated since engine_init()
+} engine;
+
+extern const unsigned char engineChannels;	// N_CH
+
+void engine_init(engine *e);	// The modulators of main.c after reset
+void engine_generate(engine *e, unsigned int *frames, unsigned long n);
+unsigned int engine_step(engine *e);	// One frame via calc_output_bits()
+
+#endif
@@ -0,0 +1,73 @@
+//******************************************************************************
+//	Envelope generators - arena and scheduler, see envgen.h
+//******************************************************************************
+
+#include "envgen.h"
+
+#define ALIGN			(sizeof(void *) > sizeof(double) ? sizeof(void *) : \
+							sizeof(double))
+
+void envgen_init(envgen_sched *s, void *arena, size_t size) {
+	s->arena = arena;
+	s->size = size;
+	s->steps = 0;
+	envgen_reset(s);
+}
+
+void envgen_reset(envgen_sched *s) {
+	s->used = 0;
+	s->head = s->tail = NULL;
+	s->nLive = 0;
+}
+
+void *envgen_new(envgen_sched *s, size_t size, envgen_fn fn, int ch) {
+//------------------------------------------------------------------------------
+// A generator struct of size bytes from the arena, envgen first, zeroed and
+// added after the live ones; NULL when the arena is full
+//------------------------------------------------------------------------------
+	envgen *g;
+	size_t i;
+
+	size = (size + ALIGN - 1) / ALIGN * ALIGN;
+	if (size < sizeof(envgen) || size > s->size - s->used)
+		return NULL;
+	g = (envgen *)(s->arena + s->used);
+	s->used += size;
+	for (i = 0; i < size; ++i)
+		((unsigned char *)g)[i] = 0;
+	g->fn = fn;
+	g->ch = ch;
+	if (s->tail)
+		s->tail->next = g;
+	else
+		s->head = g;
+	s->tail = g;
+	++s->nLive;
+	return g;
+}
+
+unsigned int envgen_step(envgen_sched *s, unsigned char *req) {
+//------------------------------------------------------------------------------
+// One envelope step: resume every live generator, its value into req[ch].
+// Ended ones leave the list; their arena space comes back with
+// envgen_reset(). Returns the generators still live.
+//------------------------------------------------------------------------------
+	envgen *g, *prev = NULL;
+
+	for (g = s->head; g; g = g->next)
+		if (g->fn(g)) {
+			req[g->ch] = g->val;
+			++s->steps;
+			prev = g;
+		}
+		else {
+			if (prev)
+				prev->next = g->next;
+			else
+				s->head = g->next;
+			if (s->tail == g)
+				s->tail = prev;
+			--s->nLive;
+		}
+	return s->nLive;
+}
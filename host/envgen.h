@@ -0,0 +1,77 @@
+//******************************************************************************
+//	Envelope generators - shows written as straight-line code, see envgen.c
+//
+//	Description:
+//		A generator is a function that yields one request value per
+//		envelope step, written as a loop or a sequence of fades, and is
+//		resumed where it yielded on the next step:
+//
+//			typedef struct {
+//				envgen g;				// First, the scheduler's part
+//				int i;					// Locals that live across yields
+//			} blink;
+//
+//			static int blink_run(envgen *g) {
+//				blink *b = (blink *)g;
+//
+//				ENVGEN_BEGIN(g);
+//				for (;;) {
+//					for (b->i = 0; b->i < 10; ++b->i)
+//						ENVGEN_YIELD(g, 200);
+//					for (b->i = 0; b->i < 10; ++b->i)
+//						ENVGEN_YIELD(g, 0);
+//				}
+//				ENVGEN_END(g);
+//			}
+//
+//			blink *b = envgen_new(&sched, sizeof(blink), blink_run, channel);
+//
+//		The resume point is a case label of a switch around the body (as
+//		in protothreads), so a generator costs its struct, no stack of its
+//		own: locals that live across a yield go in the struct, and there
+//		must be no other switch around a yield. Returning from the body
+//		(ENVGEN_END) ends the generator; its channel keeps the last value.
+//
+//		The structs come from an arena in memory the caller gives to
+//		envgen_init(), taken in order and given back all at once, so
+//		thousands of generators make no heap traffic. envgen_step()
+//		resumes every live generator once, in the order they were made,
+//		and writes what each yields into the request array of the caller,
+//		e.g. req[] of the firmware or an engine (engine.h).
+//******************************************************************************
+
+#ifndef HOST_ENVGEN_H
+#define HOST_ENVGEN_H
+
+#include <stddef.h>
+
+typedef struct envgen envgen;
+typedef int (*envgen_fn)(envgen *g);	// 1 = yielded, 0 = ended
+
+struct envgen {
+	envgen_fn fn;
+	int line;					// Resume point, 0 = start
+	unsigned char val;			// Last value yielded
+	unsigned char ch;			// Request it goes to
+	envgen *next;				// Next live generator
+};
+
+typedef struct {
+	unsigned char *arena;		// Generator structs, made in order
+	size_t size, used;
+	envgen *head, *tail;		// Generators still running, in order
+	unsigned int nLive;
+	unsigned long steps;		// Yields served since envgen_init()
+} envgen_sched;
+
+#define ENVGEN_BEGIN(g)			switch ((g)->line) { case 0:
+#define ENVGEN_YIELD(g, v)		do { (g)->val = (v); (g)->line = __LINE__; \
+									return 1; case __LINE__:; } while (0)
+#define ENVGEN_END(g)			} (g)->line = -1; return 0
+
+void envgen_init(envgen_sched *s, void *arena, size_t size);
+void *envgen_new(envgen_sched *s, size_t size, envgen_fn fn, int ch);
+unsigned int envgen_step(envgen_sched *s, unsigned char *req);	// Live left
+void envgen_reset(envgen_sched *s);	// Drop every generator, arena free
+
+#endif
@@ -0,0 +1,69 @@
+//******************************************************************************
+//	Host side of the frame protocol - encoder, decoder and CRC-8, see frame.h
+//******************************************************************************
+
+#include "frame.h"
+
+static const unsigned char crcNib[16] = {	// Same table as main.c
+	0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+	0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D };
+
+unsigned char frame_crc8(unsigned char crc, const unsigned char *p, int len) {
+//------------------------------------------------------------------------------
+// Continue a CRC-8 over len bytes, a nibble at a time like the firmware
+//------------------------------------------------------------------------------
+	while (len--) {
+		crc ^= *p++;
+		crc = (crc << 4) ^ crcNib[crc >> 4];
+		crc = (crc << 4) ^ crcNib[crc >> 4];
+	}
+	return crc;
+}
+
+int frame_encode(unsigned char *buf, unsigned int map,
+		const unsigned char *val) {
+//------------------------------------------------------------------------------
+// Frame for the channels in map, val[] indexed by channel; returns its length
+//------------------------------------------------------------------------------
+	int n, len = 3;
+
+	buf[0] = FRAME_START;
+	buf[1] = map & 0xFF;
+	buf[2] = map >> 8;
+	for (n = 0; n < 16; ++n)
+		if (map & (1U << n))
+			buf[len++] = val[n];
+	buf[len] = frame_crc8(0, buf + 1, len - 1);
+	return len + 1;
+}
+
+int frame_decode(const unsigned char *buf, int len, unsigned int *map,
+		unsigned char *val) {
+//------------------------------------------------------------------------------
+// Frame at the start of buf: its length, or FRAME_SHORT, FRAME_BAD_CRC or
+// FRAME_NO_START. Only the channels in *map are written to val[].
+//------------------------------------------------------------------------------
+	unsigned int m;
+	int n, end = 3;
+
+	if (len < 1)
+		return FRAME_SHORT;
+	if (buf[0] != FRAME_START)
+		return FRAME_NO_START;
+	if (len < 3)
+		return FRAME_SHORT;
+	m = buf[1] | (buf[2] << 8);
+	for (n = 0; n < 16; ++n)
+		if (m & (1U << n))
+			++end;
+	if (len <= end)
+		return FRAME_SHORT;
+	if (frame_crc8(0, buf + 1, end - 1) != buf[end])
+		return FRAME_BAD_CRC;
+
+	*map = m;
+	for (n = 0, end = 3; n < 16; ++n)
+		if (m & (1U << n))
+			val[n] = buf[end++];
+	return end + 1;
+}
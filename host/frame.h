@@ -0,0 +1,32 @@
+//******************************************************************************
+//	Host side of the frame protocol (see frame_rx() in main.c)
+//
+//	Description:
+//		A frame updates any set of channels in one message that the
+//		firmware applies on a single tick:
+//			FRAME_START, map low, map high, values, CRC
+//		with one value per channel set in the 16 bit map, lowest channel
+//		first, and the CRC-8 (polynomial 0x07, initial value 0, the SMBus
+//		PEC) of the map and the values.
+//
+//		The functions keep no state and do not allocate, so they can be
+//		used from the simulator tools as well as from a program that talks
+//		to the LaunchPad over its serial port.
+//******************************************************************************
+
+#ifndef HOST_FRAME_H
+#define HOST_FRAME_H
+
+#define FRAME_START		0xFE	// 0x80 + UART_CH_FRAME
+#define FRAME_MAX		20		// Longest frame, all 16 channels
+#define FRAME_SHORT		0		// frame_decode(): need more bytes
+#define FRAME_BAD_CRC	-1		// frame_decode(): CRC mismatch
+#define FRAME_NO_START	-2		// frame_decode(): buf[0] is no FRAME_START
+
+unsigned char frame_crc8(unsigned char crc, const unsigned char *p, int len);
+int frame_encode(unsigned char *buf, unsigned int map,
+		const unsigned char *val);
+int frame_decode(const unsigned char *buf, int len, unsigned int *map,
+		unsigned char *val);
+
+#endif
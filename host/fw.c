@@ -0,0 +1,31 @@
+//******************************************************************************
+//	Firmware under simulation - main.c compiled for the host
+//
+//	Description:
+//		main() is renamed so the simulator can run it as a coroutine, and
+//		the few hardware constants the simulator needs are exported.
+//******************************************************************************
+
+#define main fw_main
+#include "../main.c"
+#undef main
+
+const unsigned char fwChannels = N_CH;
+const unsigned char fwAnode1 = P1_COMM_ANOD;
+const unsigned char fwAnode2 = P2_COMM_ANOD;
+const unsigned char fwInc[N_CH] = {	// Envelope step of each channel
+	INC_CH_0_2, INC_CH_0_2, INC_CH_0_2, INC_CH_3_5, INC_CH_3_5, INC_CH_3_5,
+	INC_CH_6_7, INC_CH_6_7, INC_CH_8_9, INC_CH_8_9 };
+const unsigned char fwSteps[N_CH] = {	// Envelope steps of each fade
+	STEPS_CH_0_2, STEPS_CH_0_2, STEPS_CH_0_2, STEPS_CH_3_5, STEPS_CH_3_5,
+	STEPS_CH_3_5, STEPS_CH_6_7, STEPS_CH_6_7, STEPS_CH_8_9, STEPS_CH_8_9 };
+const unsigned char fwLoopSpeed = LOOP_SPEED;
+const unsigned char fwLoopMax = LOOP_SPEED_MAX;	// Largest LOOP_SPEED here
+#if SPREAD_TICK
+const unsigned int fwTickMin = SPREAD_MIN;	// Shortest tick, SMCLK cycles
+#else
+const unsigned int fwTickMin = TICK_CYCLES;
+#endif
+const unsigned char fwMod[N_CH] = {	// Modulation policy of each channel
+	MOD_CH_0_2, MOD_CH_0_2, MOD_CH_0_2, MOD_CH_3_5, MOD_CH_3_5, MOD_CH_3_5,
+	MOD_CH_6_7, MOD_CH_6_7, MOD_CH_8_9, MOD_CH_8_9 };
@@ -0,0 +1,420 @@
+//******************************************************************************
+//	lightd - control daemon for the LED board, real or simulated
+//
+//	Description:
+//		Clients connect to a Unix socket and send text lines:
+//			set CH VAL [CH VAL ...]	- request levels, "ok" once queued
+//			host 0|1				- 0 hands req[] back to the envelopes
+//			get						- levels last sent, one per channel
+//			stats					- counters and latency percentiles
+//		(rejected frames and missed ticks are only known in the simulator)
+//		Commands that arrive while a frame is on the wire are merged, the
+//		latest value per channel wins, and go out together as the next
+//		frame (see frame.h), so the board applies each batch on one tick.
+//
+//		The device is a board on a serial port (-d) or, by default, main.c
+//		running in the simulator in real time. Both get the same bytes.
+//		Latency is measured from the command line read to the tick that
+//		applies it: the simulator reports the commit, for a board it is
+//		the end of the frame on the wire plus one tick.
+//
+//		With -w every write to the device is also logged with its tick
+//		time (ctllog.h), in both modes, for sim_replay.
+//
+//	Build:
+//		gcc -O2 -Ihost -DSOFT_UART=1 -o lightd
+//			host/fw.c host/sim.c host/frame.c host/ctllog.c host/lightd.c -lm
+//	Run:
+//		./lightd [-s socket] [-d /dev/ttyACM0] [-b baud] [-w log]
+//		echo "set 0 100 3 50" | nc -U /tmp/lightd.sock
+//******************************************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "msp430g2211.h"
+#include "sim.h"
+#include "frame.h"
+#include "ctllog.h"
+
+#define CHANNELS		10		// N_CH in main.c
+#define CLIENTS			16
+#define LINE			256		// Longest command line
+#define INFLIGHT		64		// Frames sent, not yet applied
+#define LATENCIES		65536	// Latencies kept for the percentiles
+#define TICK_NS			(1000000000ULL * SIM_TICK / SIM_SMCLK)
+
+extern unsigned char frmReady;
+
+static struct client { int fd, len; char buf[LINE]; } client[CLIENTS];
+static int listenFd, serialFd = -1;
+static unsigned int baud = 115200;
+static ctllog rec;				// Traffic log, rec.f NULL = off
+static volatile sig_atomic_t stop;
+
+static unsigned char want[16], sent[16];	// Queued and last sent levels
+static unsigned int wantMap;	// Channels queued for the next frame
+static unsigned long long oldest;	// Read time of the oldest queued command
+static int hostReq = -1;		// Queued host command, -1 = none
+static int hostLast;			// 1 = it came after the queued levels
+
+static struct { unsigned long long read, done; } flight[INFLIGHT];
+static int flightHead, flightTail;	// Frames on the wire or in frmVal[]
+static unsigned long long linkFree;	// Wall time the link is idle again
+
+static unsigned int lat[LATENCIES];	// Microseconds, ring
+static unsigned long nLat, nCmd, nFrame, nBytes;
+
+//------------------------------------------------------------------------------
+// Time
+//------------------------------------------------------------------------------
+static unsigned long long now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static unsigned long long simStart;	// Wall time of sim cycle 0
+
+static unsigned long long sim_ns(sim_time t) {
+	return simStart + t * 1000000000ULL / SIM_SMCLK;
+}
+
+static sim_time ns_sim(unsigned long long ns) {
+	return (ns - simStart) * SIM_SMCLK / 1000000000ULL;
+}
+
+//------------------------------------------------------------------------------
+// Device side
+//------------------------------------------------------------------------------
+static void applied(unsigned long long t) {
+//	Oldest frame in flight reached req[] at wall time t
+	if (flightHead == flightTail)
+		return;
+	lat[nLat++ % LATENCIES] =
+			(unsigned int)((t - flight[flightTail].read) / 1000);
+	flightTail = (flightTail + 1) % INFLIGHT;
+}
+
+static void watch_commit(void) {
+//------------------------------------------------------------------------------
+// simHook - frmReady falls when the main loop commits a frame
+//------------------------------------------------------------------------------
+	static unsigned char ready;
+
+	if (ready && !frmReady)
+		applied(sim_ns(simNow));
+	ready = frmReady;
+}
+
+static void dev_write(const unsigned char *p, int len) {
+//	Queue bytes after anything still on the wire
+	unsigned long long t = now_ns();
+	sim_time s;
+	int i;
+
+	if (linkFree < t)
+		linkFree = t;
+	nBytes += len;
+	if (serialFd >= 0) {
+		if (rec.f)
+			ctllog_write(&rec, ns_sim(linkFree), p, len);
+		if (write(serialFd, p, len) != len)
+			perror("lightd: serial");
+		linkFree += len * 10000000000ULL / baud;
+		return;
+	}
+	s = ns_sim(linkFree);
+	if (s < simNow)
+		s = simNow;
+	if (rec.f)
+		ctllog_write(&rec, s, p, len);
+	for (i = 0; i < len; ++i)
+		s = sim_uart_tx(s, p[i], (double)SIM_SMCLK / baud, BIT2);
+	linkFree = sim_ns(s);
+}
+
+static void dev_run(void) {
+//	Simulator: catch up with the wall clock. Board: frames past the wire
+//	plus a tick count as applied.
+	unsigned long long t = now_ns();
+	sim_time s;
+
+	if (serialFd >= 0) {
+		while (flightHead != flightTail &&
+				flight[flightTail].done + TICK_NS <= t)
+			applied(flight[flightTail].done + TICK_NS);
+		return;
+	}
+	s = ns_sim(t);
+	if (s > simNow + SIM_TICK)
+		sim_run((unsigned long)((s - simNow) / SIM_TICK));
+}
+
+static int dev_open(const char *dev) {
+//	Serial port in raw 8N1 at baud, or the simulator when dev is NULL
+	static const struct { unsigned int baud; speed_t code; } speeds[] = {
+		{ 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 },
+		{ 57600, B57600 }, { 115200, B115200 } };
+	struct termios tio;
+	unsigned char sync = 0x55;		// UART_SYNC, autobaud
+	int i;
+
+	simStart = now_ns();			// Tick times in the log for both
+	if (!dev) {
+		sim_edge(0, BIT2, 1);		// RXD idles high
+		sim_reset();
+		simHook = watch_commit;
+	}
+	else {
+		for (i = 0; i < 5 && speeds[i].baud != baud; ++i)
+			;
+		serialFd = open(dev, O_RDWR | O_NOCTTY);
+		if (i == 5 || serialFd < 0 || tcgetattr(serialFd, &tio)) {
+			fprintf(stderr, "lightd: cannot open %s at %u baud\n", dev, baud);
+			return -1;
+		}
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, speeds[i].code);
+		cfsetospeed(&tio, speeds[i].code);
+		tcsetattr(serialFd, TCSANOW, &tio);
+	}
+	dev_write(&sync, 1);
+	return 0;
+}
+
+static void send_host(void) {
+//	The queued host command, 0x80 + UART_CH_HOST, value
+	unsigned char cmd[2] = { 0xFF, hostReq };
+
+	dev_write(cmd, 2);
+	hostReq = -1;
+}
+
+static void flush_batch(void) {
+//------------------------------------------------------------------------------
+// Send the queued commands as one frame once the link is idle, and a queued
+// host command before or after it, in the order the client sent them: a
+// frame sets hostCtl, so "set" then "host 0" has to end with the host
+// command or the envelopes would never resume
+//------------------------------------------------------------------------------
+	unsigned char buf[FRAME_MAX];
+	int n, len;
+
+	if (now_ns() < linkFree)
+		return;						// Still sending, keep merging
+	if (hostReq >= 0 && !(hostLast && wantMap))
+		send_host();
+	if (!wantMap || (flightHead + 1) % INFLIGHT == flightTail)
+		return;
+	len = frame_encode(buf, wantMap, want);
+	dev_write(buf, len);
+	for (n = 0; n < CHANNELS; ++n)
+		if (wantMap & (1U << n))
+			sent[n] = want[n];
+	flight[flightHead].read = oldest;
+	flight[flightHead].done = linkFree;
+	flightHead = (flightHead + 1) % INFLIGHT;
+	wantMap = 0;
+	++nFrame;
+	if (hostReq >= 0)
+		send_host();
+}
+
+//------------------------------------------------------------------------------
+// Client side
+//------------------------------------------------------------------------------
+static int cmp_uint(const void *a, const void *b) {
+	return *(const unsigned int *)a > *(const unsigned int *)b ? 1 :
+			*(const unsigned int *)a < *(const unsigned int *)b ? -1 : 0;
+}
+
+static void stats(char *out) {
+	static unsigned int s[LATENCIES];
+	unsigned long n = nLat < LATENCIES ? nLat : LATENCIES;
+
+	memcpy(s, lat, n * sizeof(s[0]));
+	qsort(s, n, sizeof(s[0]), cmp_uint);
+	sprintf(out, "commands %lu frames %lu bytes %lu rejected %u "
+			"missed %lu p50 %u p90 %u p99 %u max %u us\n", nCmd, nFrame, nBytes,
+			serialFd < 0 ? errCnt : 0, serialFd < 0 ? simMissed : 0,
+			n ? s[n / 2] : 0, n ? s[n * 9 / 10] : 0, n ? s[n * 99 / 100] : 0,
+			n ? s[n - 1] : 0);
+}
+
+static int command(int fd, char *line) {
+//	One line from a client, the reply goes straight back; -1 = client gone
+	char out[LINE], *tok = strtok(line, " \t\r");
+	unsigned int map = 0, ch, val;
+	unsigned char v[16];
+	int n;
+
+	if (!tok)
+		return 0;
+	if (!strcmp(tok, "set")) {
+		while ((tok = strtok(NULL, " \t\r"))) {
+			if (sscanf(tok, "%u", &ch) != 1 || ch >= CHANNELS ||
+					!(tok = strtok(NULL, " \t\r")) ||
+					sscanf(tok, "%u", &val) != 1 || val > 255) {
+				map = 0;			// Whole line rejected, odd count too
+				break;
+			}
+			map |= 1U << ch;
+			v[ch] = val;
+		}
+		if (!map)
+			strcpy(out, "error: set CH VAL [CH VAL ...]\n");
+		else {
+			if (!wantMap)
+				oldest = now_ns();
+			for (n = 0; n < CHANNELS; ++n)
+				if (map & (1U << n))
+					want[n] = v[n];
+			wantMap |= map;
+			hostLast = 0;
+			++nCmd;
+			strcpy(out, "ok\n");
+		}
+	}
+	else if (!strcmp(tok, "host") && (tok = strtok(NULL, " \t\r")) &&
+			sscanf(tok, "%u", &val) == 1 && val <= 1) {
+		hostReq = val;
+		hostLast = 1;
+		strcpy(out, "ok\n");
+	}
+	else if (!strcmp(tok, "get")) {
+		for (n = 0, out[0] = 0; n < CHANNELS; ++n)
+			sprintf(out + strlen(out), n ? " %u" : "%u", sent[n]);
+		strcat(out, "\n");
+	}
+	else if (!strcmp(tok, "stats"))
+		stats(out);
+	else
+		strcpy(out, "error: unknown command\n");
+	return write(fd, out, strlen(out)) < 0 ? -1 : 0;
+}
+
+static void on_signal(int sig) {
+	stop = sig;
+}
+
+static void client_read(struct client *c) {
+	char *nl;
+	int r = read(c->fd, c->buf + c->len, LINE - 1 - c->len);
+
+	if (r <= 0) {
+		close(c->fd);
+		c->fd = -1;
+		return;
+	}
+	c->len += r;
+	c->buf[c->len] = 0;
+	while ((nl = strchr(c->buf, '\n'))) {
+		*nl = 0;
+		if (command(c->fd, c->buf) < 0) {
+			close(c->fd);			// Reply failed, client gone
+			c->fd = -1;
+			return;
+		}
+		c->len -= nl + 1 - c->buf;
+		memmove(c->buf, nl + 1, c->len + 1);
+	}
+	if (c->len == LINE - 1)
+		c->len = 0;					// Line too long, drop it
+}
+
+int main(int argc, char **argv) {
+	const char *path = "/tmp/lightd.sock", *dev = NULL, *log = NULL;
+	struct sockaddr_un addr;
+	struct pollfd pfd[CLIENTS + 1];
+	int i, n, opt;
+
+	while ((opt = getopt(argc, argv, "s:d:b:w:")) != -1) {
+		if (opt == 's')
+			path = optarg;
+		else if (opt == 'd')
+			dev = optarg;
+		else if (opt == 'b')
+			baud = atoi(optarg);
+		else if (opt == 'w')
+			log = optarg;
+		else {
+			fprintf(stderr, "usage: lightd [-s socket] [-d tty] [-b baud] "
+					"[-w log]\n");
+			return 2;
+		}
+	}
+	if (!dev && baud != 115200 && baud != 9600) {
+		fprintf(stderr, "lightd: simulated baud rate 9600 or 115200\n");
+		return 2;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	signal(SIGINT, on_signal);		// Stop cleanly, the log is complete
+	signal(SIGTERM, on_signal);
+	if (log && !ctllog_create(&rec, log, baud)) {
+		perror("lightd: log");
+		return 1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	unlink(path);
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0 || bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) ||
+			listen(listenFd, 4)) {
+		perror("lightd: socket");
+		return 1;
+	}
+	if (dev_open(dev))
+		return 1;
+	for (i = 0; i < CLIENTS; ++i)
+		client[i].fd = -1;
+	fprintf(stderr, "lightd: %s on %s\n", dev ? dev : "simulator", path);
+
+	while (!stop) {
+		pfd[0].fd = listenFd;
+		pfd[0].events = POLLIN;
+		for (i = 0; i < CLIENTS; ++i) {
+			pfd[i + 1].fd = client[i].fd;
+			pfd[i + 1].events = POLLIN;
+		}
+		n = poll(pfd, CLIENTS + 1, 1);	// Wakes each ms to run the device
+		if (n < 0) {
+			if (errno != EINTR)
+				break;
+			continue;
+		}
+
+		if (pfd[0].revents & POLLIN) {
+			for (i = 0; i < CLIENTS && client[i].fd >= 0; ++i)
+				;
+			n = accept(listenFd, NULL, NULL);
+			if (i == CLIENTS)
+				close(n);			// Full
+			else if (n >= 0) {
+				client[i].fd = n;
+				client[i].len = 0;
+			}
+		}
+		for (i = 0; i < CLIENTS; ++i)
+			if (client[i].fd >= 0 && (pfd[i + 1].revents & (POLLIN | POLLHUP)))
+				client_read(&client[i]);
+
+		flush_batch();
+		dev_run();
+	}
+	ctllog_close(&rec);
+	unlink(path);
+	return !stop;
+}
@@ -0,0 +1,108 @@
+//******************************************************************************
+//	lightload - load test for lightd
+//
+//	Description:
+//		Opens a number of client connections to lightd and sends "set"
+//		commands with random channels and levels from all of them at a
+//		fixed total rate. Every command must be answered with "ok". At the
+//		end the daemon's "stats" line is printed: frames against commands
+//		shows the batching, the percentiles the command to tick latency.
+//
+//	Build:
+//		gcc -O2 -o lightload host/lightload.c
+//	Run:
+//		./lightload [-s socket] [-c clients] [-r commands/s] [-t seconds]
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define CHANNELS		10
+#define CLIENTS			16		// CLIENTS in lightd.c
+
+static int dial(const char *path) {
+	struct sockaddr_un addr;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		perror("lightload: connect");
+		exit(1);
+	}
+	return fd;
+}
+
+static int reply(int fd, char *buf, int size) {
+//	One line from lightd, 0 if the connection is gone
+	int n = 0;
+
+	while (n < size - 1 && read(fd, buf + n, 1) == 1)
+		if (buf[n++] == '\n')
+			break;
+	buf[n] = 0;
+	return n;
+}
+
+int main(int argc, char **argv) {
+	const char *path = "/tmp/lightd.sock";
+	int fd[CLIENTS], nClients = 4, rate = 1000, secs = 5;
+	char line[256];
+	struct timespec gap;
+	long i, sent, bad = 0;
+	int c, n, k, opt;
+
+	while ((opt = getopt(argc, argv, "s:c:r:t:")) != -1) {
+		if (opt == 's')
+			path = optarg;
+		else if (opt == 'c')
+			nClients = atoi(optarg);
+		else if (opt == 'r')
+			rate = atoi(optarg);
+		else if (opt == 't')
+			secs = atoi(optarg);
+		else {
+			fprintf(stderr, "usage: lightload [-s socket] [-c clients] "
+					"[-r commands/s] [-t seconds]\n");
+			return 2;
+		}
+	}
+	if (nClients < 1 || nClients > CLIENTS || rate < 1 || secs < 1) {
+		fprintf(stderr, "lightload: 1 ... %d clients, rate and time > 0\n",
+				CLIENTS);
+		return 2;
+	}
+	for (c = 0; c < nClients; ++c)
+		fd[c] = dial(path);
+
+	sent = (long)rate * secs;
+	gap.tv_sec = 0;
+	gap.tv_nsec = 1000000000L / rate;
+	for (i = 0; i < sent; ++i) {
+		c = i % nClients;
+		strcpy(line, "set");
+		for (n = 0, k = 1 + rand() % 3; n < k; ++n)
+			sprintf(line + strlen(line), " %d %d", rand() % CHANNELS,
+					rand() % 256);
+		strcat(line, "\n");
+		if (write(fd[c], line, strlen(line)) < 0 || !reply(fd[c], line, 256))
+			return 1;
+		bad += strcmp(line, "ok\n") != 0;
+		nanosleep(&gap, NULL);
+	}
+	usleep(100000);					// Last frame applied
+
+	write(fd[0], "stats\n", 6);
+	reply(fd[0], line, 256);
+	printf("%d clients, %ld commands at %d/s, %ld refused\nlightd: %s",
+			nClients, sent, rate, bad, line);
+	for (c = 0; c < nClients; ++c)
+		close(fd[c]);
+	return bad != 0;
+}
@@ -0,0 +1,164 @@
+//******************************************************************************
+//	Host stand-in for the TI "msp430g2211.h" device header.
+//
+//	Description:
+//		Only used when the firmware sources are compiled on a PC for the
+//		simulator (see sim.c). Every peripheral register the firmware touches
+//		is a plain variable owned by the simulator, and the few intrinsics
+//		that change the CPU state are routed to simulator functions.
+//		P1DIR is read through a function so the simulator sees a pin that
+//		is pulled low and released again inside one ISR (clock stretching),
+//		CACTL2 so that CAOUT follows the analog model at the time of reading.
+//		FCTL1 and FCTL3 go through a function too: on each access the
+//		simulator programs or erases what the firmware stored into
+//		information memory since the last one, which is the array INFO_D.
+//
+//		Register names and bit values follow the TI header, so the firmware
+//		compiles unchanged. Add new registers here when the firmware starts
+//		using them.
+//******************************************************************************
+
+#ifndef HOST_MSP430G2211_H
+#define HOST_MSP430G2211_H
+
+//------------------------------------------------------------------------------
+// Intrinsics and compiler keywords
+//------------------------------------------------------------------------------
+void sim_lpm0(void);				// Enter LPM0, return on wake-up
+void sim_wake(void);				// Clear LPM bits of the interrupted context
+void sim_gie(int on);				// Set or clear the GIE bit
+
+#define __interrupt
+#define __enable_interrupt()	sim_gie(1)
+#define __disable_interrupt()	sim_gie(0)
+#define _BIC_SR_IRQ(x)			sim_wake()
+#define LPM0					sim_lpm0()
+#define LPM0_bits				0x0010
+
+//------------------------------------------------------------------------------
+// Special function registers
+//------------------------------------------------------------------------------
+extern unsigned char IE1, IFG1;
+
+#define WDTIE			0x01
+#define WDTIFG			0x01
+
+//------------------------------------------------------------------------------
+// Watchdog timer
+//------------------------------------------------------------------------------
+extern unsigned int WDTCTL;
+
+#define WDTPW			0x5A00
+#define WDTHOLD			0x0080
+#define WDTTMSEL		0x0010
+#define WDTCNTCL		0x0008
+#define WDTIS0			0x0001
+#define WDT_MDLY_32		(WDTPW+WDTTMSEL+WDTCNTCL)
+#define WDT_MDLY_8		(WDTPW+WDTTMSEL+WDTCNTCL+WDTIS0)
+
+//------------------------------------------------------------------------------
+// Basic clock module
+//------------------------------------------------------------------------------
+extern unsigned char DCOCTL, BCSCTL1, BCSCTL2, BCSCTL3;
+
+#define DCO2			0x80
+#define RSEL3			0x08
+
+//------------------------------------------------------------------------------
+// Digital I/O
+//------------------------------------------------------------------------------
+extern unsigned char P1IN, P1OUT, P1IFG, P1IES, P1IE, P1SEL, P1REN;
+unsigned char *sim_p1dir(void);		// Also records the values set in an ISR
+#define P1DIR			(*sim_p1dir())
+extern unsigned char P2IN, P2OUT, P2DIR, P2IFG, P2IES, P2IE, P2SEL, P2REN;
+
+#define BIT0			0x01
+#define BIT1			0x02
+#define BIT2			0x04
+#define BIT3			0x08
+#define BIT4			0x10
+#define BIT5			0x20
+#define BIT6			0x40
+#define BIT7			0x80
+
+//------------------------------------------------------------------------------
+// Timer_A2
+//------------------------------------------------------------------------------
+extern unsigned int TACTL, TAR, TAIV;
+extern unsigned int TACCTL0, TACCTL1, TACCR0, TACCR1;
+
+#define TASSEL_2		0x0200		// SMCLK
+#define MC_0			0x0000		// Stop
+#define MC_1			0x0010		// Up to TACCR0
+#define MC_2			0x0020		// Continuous
+#define TACLR			0x0004
+#define TAIE			0x0002
+#define TAIFG			0x0001
+
+#define CM_0			0x0000		// No capture
+#define CM_1			0x4000		// Capture on rising edge
+#define CM_2			0x8000		// Capture on falling edge
+#define CM_3			0xC000		// Capture on both edges
+#define CCIS_0			0x0000		// CCIxA
+#define CCIS_1			0x1000		// CCIxB
+#define SCS				0x0800		// Synchronous capture
+#define SCCI			0x0400		// Latched input
+#define CAP				0x0100		// Capture mode
+#define CCIE			0x0010
+#define CCI				0x0008		// Input value
+#define OUT				0x0004		// Output value in OUTMOD_0
+#define COV				0x0002
+#define CCIFG			0x0001
+
+#define TAIV_TACCR1		0x0002
+#define TAIV_TAIFG		0x000A
+
+//------------------------------------------------------------------------------
+// Comparator_A+
+//------------------------------------------------------------------------------
+extern unsigned char CACTL1, CAPD;
+unsigned char *sim_cactl2(void);	// Updates CAOUT from the analog model
+#define CACTL2			(*sim_cactl2())
+
+#define CAEX			0x80
+#define CARSEL			0x40		// Reference to the - terminal
+#define CAREF_1			0x10		// 0.25 Vcc
+#define CAREF_2			0x20		// 0.5 Vcc
+#define CAREF_3			0x30		// Diode
+#define CAON			0x08
+#define CAIES			0x04
+#define CAIE			0x02
+#define CAIFG			0x01
+
+#define P2CA4			0x40
+#define P2CA3			0x20
+#define P2CA2			0x10
+#define P2CA1			0x08
+#define P2CA0			0x04
+#define CAF				0x02
+#define CAOUT			0x01
+
+//------------------------------------------------------------------------------
+// Flash memory controller and information memory (segments D, C, B, A)
+//------------------------------------------------------------------------------
+extern unsigned int FCTL2;
+unsigned int *sim_fctl(int n);		// Applies stores into INFO_D, see sim.c
+#define FCTL1			(*sim_fctl(1))
+#define FCTL3			(*sim_fctl(3))
+extern unsigned char simInfo[256];
+#define INFO_D			simInfo		// 0x1000 on the target
+
+#define FWKEY			0xA500
+#define ERASE			0x0002		// FCTL1
+#define MERAS			0x0004
+#define WRT				0x0040
+#define FSSEL_1			0x0040		// FCTL2: MCLK
+#define FSSEL_2			0x0080		// SMCLK
+#define BUSY			0x0001		// FCTL3
+#define KEYV			0x0002
+#define WAIT			0x0008
+#define LOCK			0x0010
+#define EMEX			0x0020
+#define LOCKA			0x0040
+
+#endif
@@ -0,0 +1,337 @@
+//******************************************************************************
+//	Noise transfer function search for the NTF_SHAPED modulators
+//
+//	Description:
+//		With NTF_SHAPED each channel is an error feedback modulator: the
+//		quantizer sees v = req + g1 e[n-1] + ... + gN e[n-N], where e is
+//		what the quantizer added (0 or max, minus v), so the output is the
+//		input plus e shaped by NTF(z) = 1 + g1 z^-1 + ... + gN z^-N.
+//
+//		The G2211 has no multiplier and a right shift would round, and the
+//		rounding would not be shaped, so every gk is 0 or +-1, 2, 4, 8: a
+//		left shift and an add. ntf.h writes them as products, e[k] * 2,
+//		which compile to the same shift; a << of a negative e would be
+//		undefined. NTF(1) = 0, i.e. g1 + ... + gN = -1, keeps the average
+//		exact.
+//
+//		A one bit quantizer overloads a higher order loop near 0 and max,
+//		so below max >> NTF_EDGE and above max minus that the firmware
+//		falls back to first order (g1 = -1) on the same error history.
+//		This tool tries all such NTFs of order 2 ... N with every edge,
+//		one thread per CPU. Each candidate is run at every req of every
+//		resolution in max[] as built, then on a ramp from 0 to max and
+//		back, and scored by the mean visible noise over those levels, the
+//		output error through the eye model of sim_flicker() (three
+//		first-order stages at 20 Hz). FLASH_CFG and the host links can
+//		set any max, so a candidate is only stable if |e| stays within
+//		BOUND * max and no sum overflows 16 bits at max 255 for every req
+//		of every max 1 ... 255 too (as tones -a), each for STABLE ticks.
+//
+//		The best stable one is written as a header for the firmware,
+//		with the first order modulator (g1 = -1) for comparison.
+//
+//	Build:
+//		gcc -O2 -pthread -Ihost -o ntf host/fw.c host/sim.c host/ntf.c -lm
+//	Run:
+//		./ntf [-n order] [-o header]	default 3 and ntf.h
+//******************************************************************************
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define MAX_ORDER		4
+#define N_GAINS			9
+#define BOUND			4		// Largest |e| / max taken as stable
+#define EDGES			5		// NTF_EDGE 2 ... 6
+#define WARM			512		// Ticks before measuring
+#define MEASURE			4096	// Ticks measured per level
+#define RAMP			4		// Ticks per level of the ramps
+#define STABLE			1024	// Ticks per level of the other resolutions
+#define MAX_RES			255		// Largest max[] a host can set
+#define EYE_HZ			20		// Eye model of sim.c
+#define EYE_STAGES		3
+
+static const int gains[N_GAINS] = { 0, 1, -1, 2, -2, 4, -4, 8, -8 };
+
+typedef struct {
+	int order, g[MAX_ORDER];
+	int edge;					// Shaped from max >> edge to max - that
+	int stable;
+	double noise, worst;		// Visible noise, mean and worst level
+	double peak;				// Largest |e| / max
+} cand;
+
+static cand *cands;
+static int nCands, next, nRes;
+static unsigned int res[16];	// Distinct max[] values
+static double eyeA;
+
+static int step(cand *c, long *e, long x, long m, int *fail) {
+//	One tick of calc_output_bits(), 1 = quantized to max
+	long v = x, mag = labs(x);
+	int k, q;
+
+	if (x < m >> c->edge || x > m - (m >> c->edge)) {
+		v -= e[0];					// First order near the edges
+		mag += labs(e[0]);
+	}
+	else
+		for (k = 0; k < c->order; ++k) {
+			v += c->g[k] * e[k];
+			mag += labs(c->g[k] * e[k]);
+		}
+	for (k = c->order - 1; k; --k)
+		e[k] = e[k - 1];
+	q = v >= (m + 1) / 2;
+	e[0] = (q ? m : 0) - v;
+	if (labs(e[0]) > BOUND * m || mag * MAX_RES > 32767 * m)
+		*fail = 1;					// Runs away, or 16 bits overflow at max 255
+	if (labs(e[0]) > c->peak * m)
+		c->peak = (double)labs(e[0]) / m;
+	return q;
+}
+
+static void evaluate(cand *c) {
+//------------------------------------------------------------------------------
+// Every level of every resolution, integer arithmetic as on the target, then
+// a ramp over the whole range and back
+//------------------------------------------------------------------------------
+	long e[MAX_ORDER], m, i;
+	double y[EYE_STAGES], x, sq, rms, total = 0;
+	int r, k, s, fail = 0, levels = 0;
+	unsigned long t;
+
+	c->worst = c->peak = 0;
+	for (r = 0; r < nRes && !fail; ++r) {
+		m = res[r];
+		for (i = 0; i <= m && !fail; ++i, ++levels) {
+			for (k = 0; k < MAX_ORDER; ++k)
+				e[k] = 0;
+			for (s = 0; s < EYE_STAGES; ++s)
+				y[s] = 0;
+			sq = 0;
+			for (t = 0; t < WARM + MEASURE; ++t) {
+				x = step(c, e, i, m, &fail) ? 1 - (double)i / m :
+						-(double)i / m;		// Output - input
+				for (s = 0; s < EYE_STAGES; ++s)
+					x = y[s] += eyeA * (x - y[s]);
+				if (t >= WARM)
+					sq += x * x;
+			}
+			rms = sqrt(sq / MEASURE);
+			total += rms;
+			if (rms > c->worst)
+				c->worst = rms;
+		}
+		for (i = 0; i < 2 * m * RAMP && !fail; ++i)
+			step(c, e, i < m * RAMP ? i / RAMP : 2 * m - i / RAMP - 1, m, &fail);
+	}
+	c->noise = total / levels;
+
+	for (m = 1; m <= MAX_RES && !fail; ++m) {	// Stability at every max
+		for (r = 0; r < nRes && res[r] != m; ++r)
+			;
+		if (r < nRes)
+			continue;				// Done above
+		for (i = 0; i <= m && !fail; ++i) {
+			for (k = 0; k < MAX_ORDER; ++k)
+				e[k] = 0;
+			for (t = 0; t < STABLE && !fail; ++t)
+				step(c, e, i, m, &fail);
+		}
+		for (i = 0; i < 2 * m * RAMP && !fail; ++i)
+			step(c, e, i < m * RAMP ? i / RAMP : 2 * m - i / RAMP - 1, m, &fail);
+	}
+	c->stable = !fail;
+}
+
+static void *worker(void *arg) {
+	int i;
+
+	(void)arg;
+
+	while ((i = __sync_fetch_and_add(&next, 1)) < nCands)
+		evaluate(&cands[i]);
+	return NULL;
+}
+
+static void enumerate(int order, int maxOrder) {
+//	All gain vectors of this order with g1 + ... + gN = -1 and gN != 0, each
+//	with every edge; first order is the reference
+	int idx[MAX_ORDER] = { 0 }, k, sum, edge;
+
+	for (;;) {
+		for (k = sum = 0; k < order; ++k)
+			sum += gains[idx[k]];
+		for (edge = 2; sum == -1 && gains[idx[order - 1]] &&
+				edge < 2 + (order > 1 ? EDGES : 1); ++edge) {
+			cands[nCands].order = order;
+			cands[nCands].edge = order > 1 ? edge : 1;
+			for (k = 0; k < maxOrder; ++k)
+				cands[nCands].g[k] = k < order ? gains[idx[k]] : 0;
+			++nCands;
+		}
+		for (k = 0; k < order && ++idx[k] == N_GAINS; ++k)
+			idx[k] = 0;
+		if (k == order)
+			return;
+	}
+}
+
+static void ntf_text(const cand *c, char *buf) {
+//	"1 - 2 z^-1 + z^-2"
+	int k, g;
+
+	buf += sprintf(buf, "1");
+	for (k = 0; k < c->order; ++k) {
+		if (!(g = c->g[k]))
+			continue;
+		buf += sprintf(buf, " %c ", g < 0 ? '-' : '+');
+		if (abs(g) != 1)
+			buf += sprintf(buf, "%d ", abs(g));
+		buf += sprintf(buf, "z^-%d", k + 1);
+	}
+}
+
+static void write_header(const char *path, const cand *c, const cand *ref,
+		int maxOrder) {
+//------------------------------------------------------------------------------
+// ntf.h: NTF_ORDER, NTF_EDGE, the error bound and NTF_V(x, e), the quantizer
+// input from the errors
+//------------------------------------------------------------------------------
+	char text[128], expr[256], *p = expr;
+	FILE *f = fopen(path, "w");
+	int k, g;
+
+	if (!f) {
+		perror("ntf: header");
+		exit(2);
+	}
+	ntf_text(c, text);
+	p += sprintf(p, "(x)");
+	for (k = 0; k < c->order; ++k) {
+		if (!(g = c->g[k]))
+			continue;
+		if (abs(g) > 1)				// A product, e[] may be negative
+			p += sprintf(p, " %c (e)[%d] * %d", g < 0 ? '-' : '+', k, abs(g));
+		else
+			p += sprintf(p, " %c (e)[%d]", g < 0 ? '-' : '+', k);
+	}
+	fprintf(f, "//*********************************************************"
+			"*********************\n");
+	fprintf(f, "//\tNoise transfer function of the NTF_SHAPED modulators\n//\n");
+	fprintf(f, "//\tGenerated by host/ntf.c (-n %d), do not edit.\n//\n",
+			maxOrder);
+	fprintf(f, "//\tNTF(z) = %s, first order below max >> %d and above max - "
+			"that\n", text, c->edge);
+	fprintf(f, "//\tVisible noise, mean over all levels: %.4f %% (first order "
+			"%.4f %%)\n", 100 * c->noise, 100 * ref->noise);
+	fprintf(f, "//\tWorst level: %.4f %% (first order %.4f %%)\n",
+			100 * c->worst, 100 * ref->worst);
+	fprintf(f, "//\tScored at every req of max");
+	for (k = 0; k < nRes; ++k)
+		fprintf(f, " %u", res[k]);
+	fprintf(f, ",\n//\tstable at every max 1 ... %d, |e| <= %.2f max\n",
+			MAX_RES, c->peak);
+	fprintf(f, "//*********************************************************"
+			"*********************\n\n");
+	fprintf(f, "#ifndef NTF_H\n#define NTF_H\n\n");
+	fprintf(f, "#define NTF_ORDER\t\t%d\n", c->order);
+	fprintf(f, "#define NTF_EDGE\t\t%d\n", c->edge);
+	fprintf(f, "#define NTF_ERR_MAX\t\t%d\t\t// |e| < NTF_ERR_MAX * max\n",
+			(int)floor(c->peak) + 1);
+	fprintf(f, "#define NTF_V(x, e)\t\t(%s)\n\n#endif\n", expr);
+	fclose(f);
+}
+
+int main(int argc, char **argv) {
+	const char *path = "ntf.h";
+	unsigned int m;
+	int maxOrder = 3, opt, n, threads, stable = 0, order, best;
+	char text[128];
+	pthread_t *tid;
+	cand *ref = NULL, *c;
+
+	while ((opt = getopt(argc, argv, "n:o:")) != -1) {
+		if (opt == 'n')
+			maxOrder = atoi(optarg);
+		else if (opt == 'o')
+			path = optarg;
+		else
+			optind = argc + 1;
+	}
+	if (optind != argc || maxOrder < 2 || maxOrder > MAX_ORDER) {
+		fprintf(stderr, "usage: ntf [-n order 2..%d] [-o header]\n", MAX_ORDER);
+		return 2;
+	}
+	for (m = 1; m <= MAX_RES; ++m)	// Ascending, each once
+		for (n = 0; n < fwChannels; ++n)
+			if (max[n] == m) {
+				res[nRes++] = m;
+				break;
+			}
+	eyeA = 1 - exp(-2 * M_PI * EYE_HZ * SIM_TICK / SIM_SMCLK);
+
+	for (n = 1, order = 1; order <= maxOrder; ++order)
+		n *= N_GAINS;
+	cands = calloc(n * maxOrder * EDGES, sizeof(cand));
+	for (order = 1; order <= maxOrder; ++order)
+		enumerate(order, maxOrder);
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+		threads = 1;
+	tid = malloc(threads * sizeof(pthread_t));
+	for (n = 0; n < threads; ++n)
+		pthread_create(&tid[n], NULL, worker, NULL);
+	for (n = 0; n < threads; ++n)
+		pthread_join(tid[n], NULL);
+
+	printf("%d candidates on %d threads, resolutions", nCands, threads);
+	for (n = 0; n < nRes; ++n)
+		printf(" %u", res[n]);
+	printf("\n");
+	for (order = 1; order <= maxOrder; ++order) {
+		best = -1;
+		for (n = 0; n < nCands; ++n) {
+			c = &cands[n];
+			if (c->order != order || !c->stable)
+				continue;
+			if (order > 1)
+				++stable;
+			else
+				ref = c;
+			if (best < 0 || c->noise < cands[best].noise)
+				best = n;
+		}
+		if (best < 0) {
+			printf("order %d: none stable\n", order);
+			continue;
+		}
+		ntf_text(&cands[best], text);
+		printf("order %d: best %-26s edge %d, noise %.4f %%, worst level "
+				"%.4f %%, |e| <= %.2f max\n", order, text, cands[best].edge,
+				100 * cands[best].noise, 100 * cands[best].worst,
+				cands[best].peak);
+	}
+	best = -1;
+	for (n = 0; n < nCands; ++n)
+		if (cands[n].order > 1 && cands[n].stable &&
+				(best < 0 || cands[n].noise < cands[best].noise))
+			best = n;
+	printf("%d of %d higher order candidates stable\n", stable,
+			nCands - 1);
+	if (best < 0 || !ref)
+		return 1;
+	write_header(path, &cands[best], ref, maxOrder);
+	ntf_text(&cands[best], text);
+	printf("%s: NTF(z) = %s\n", path, text);
+	free(tid);
+	free(cands);
+	return 0;
+}
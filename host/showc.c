@@ -0,0 +1,285 @@
+//******************************************************************************
+//	Show compiler - envelope keyframe tables of main.c from a ramp/hold list
+//
+//	Description:
+//		Reads a show, one line per step of each channel group (# starts a
+//		comment):
+//			group 0_2 max 0 0	start of group 0_2, its channels' levels
+//			ramp steps max max 0	to these levels, one step at a time
+//			hold 20				keep the levels for 20 steps
+//		A level is max (MAX_CH_* of the group), a percentage of it (50%)
+//		or a number; the steps of a ramp or hold are steps (STEPS_CH_* of
+//		the group) or a number, 1 ... 255. Every group starts over after
+//		its last line and has to end on the levels it starts with.
+//
+//		Writes a header that main.c includes with GEN_SHOW: the initial
+//		REQ_CH_*, and one key per line, its steps and the increment of
+//		each channel for one step, as C constant expressions of MAX_CH_*
+//		and STEPS_CH_*. The checks that need those are written as #if
+//		and #error: the compiler of each build, with its -D or config.h,
+//		proves that no level goes over max and that every ramp moves its
+//		channels by a whole number of levels per step, so req[] never
+//		leaves 0 ... max and each group comes back to its start. Only the
+//		table is in flash; calc_show() adds the increments, as the fixed
+//		envelopes do.
+//
+//		show.txt in the tree is the shipped envelopes of calc_CH_*().
+//
+//	Build:
+//		gcc -O2 -o showc host/showc.c
+//	Run: (from the repository root)
+//		./showc [-o header] [show]
+//		defaults: show.h, show.txt
+//******************************************************************************
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define GROUPS			4
+#define MAX_KEYS		255		// Key index is a byte
+#define EXPR_LEN		48
+#define LINE_LEN		256
+
+static const struct {
+	const char *name;
+	int first, n;				// Channels
+} groups[GROUPS] = {
+	{ "0_2", 0, 3 }, { "3_5", 3, 3 }, { "6_7", 6, 2 }, { "8_9", 8, 2 } };
+
+typedef struct {
+	char steps[EXPR_LEN];
+	char level[3][EXPR_LEN];	// After the key
+	int line;					// In the show
+} key;
+
+static key keys[GROUPS][MAX_KEYS];
+static int nKeys[GROUPS], seen[GROUPS], startLine[GROUPS];
+static char start[GROUPS][3][EXPR_LEN];
+static const char *showPath = "show.txt";
+
+static int fail(int line, const char *msg, const char *word) {
+	fprintf(stderr, "%s:%d: %s%s%s\n", showPath, line, msg, word ? ": " : "",
+			word ? word : "");
+	return 0;
+}
+
+static int level(const char *w, int g, char *expr, int line) {
+//------------------------------------------------------------------------------
+// A level as a C expression in MAX_CH_* of group g: max, N% or N
+//------------------------------------------------------------------------------
+	char *end;
+	long v = strtol(w, &end, 10);
+
+	if (!strcmp(w, "max") || (!strcmp(end, "%") && v == 100 && end != w))
+		snprintf(expr, EXPR_LEN, "MAX_CH_%s", groups[g].name);
+	else if (end != w && !strcmp(end, "%") && v >= 0 && v < 100)
+		snprintf(expr, EXPR_LEN, v ? "(MAX_CH_%s * %ld / 100)" : "0",
+				groups[g].name, v);
+	else if (end != w && !*end && v >= 0 && v <= 255)
+		snprintf(expr, EXPR_LEN, "%ld", v);
+	else
+		return fail(line, "level is not max, 0% ... 100% or 0 ... 255", w);
+	return 1;
+}
+
+static int steps(const char *w, int g, char *expr, int line) {
+//	Steps of a ramp or hold: steps or 1 ... 255
+	char *end;
+	long v = strtol(w, &end, 10);
+
+	if (!strcmp(w, "steps"))
+		snprintf(expr, EXPR_LEN, "STEPS_CH_%s", groups[g].name);
+	else if (end != w && !*end && v >= 1 && v <= 255)
+		snprintf(expr, EXPR_LEN, "%ld", v);
+	else
+		return fail(line, "steps is not steps or 1 ... 255", w);
+	return 1;
+}
+
+static int read_show(FILE *f) {
+	char buf[LINE_LEN], *w[8], *s;
+	char (*from)[EXPR_LEN];
+	int line = 0, g = -1, n, i;
+	key *k;
+
+	while (fgets(buf, sizeof buf, f)) {
+		++line;
+		buf[strcspn(buf, "#\r\n")] = 0;
+		for (n = 0, s = strtok(buf, " \t"); s && n < 8; s = strtok(NULL, " \t"))
+			w[n++] = s;
+		if (!n)
+			continue;
+		if (!strcmp(w[0], "group")) {
+			for (g = 0; g < GROUPS && (n < 2 || strcmp(w[1], groups[g].name));
+					++g)
+				;
+			if (g == GROUPS)
+				return fail(line, "no such group (0_2, 3_5, 6_7, 8_9)",
+						n > 1 ? w[1] : NULL);
+			if (seen[g]++)
+				return fail(line, "group given twice", w[1]);
+			if (n != 2 + groups[g].n)
+				return fail(line, "wrong number of start levels", w[1]);
+			startLine[g] = line;
+			for (i = 0; i < groups[g].n; ++i)
+				if (!level(w[2 + i], g, start[g][i], line))
+					return 0;
+			continue;
+		}
+		if (g < 0)
+			return fail(line, "ramp or hold before the first group", NULL);
+		if (nKeys[g] == MAX_KEYS)
+			return fail(line, "too many keys", NULL);
+		k = &keys[g][nKeys[g]];
+		k->line = line;
+		from = nKeys[g] ? keys[g][nKeys[g] - 1].level : start[g];
+		if (!strcmp(w[0], "ramp") && n == 2 + groups[g].n) {
+			for (i = 0; i < groups[g].n; ++i)
+				if (!level(w[2 + i], g, k->level[i], line))
+					return 0;
+		}
+		else if (!strcmp(w[0], "hold") && n == 2)
+			for (i = 0; i < groups[g].n; ++i)
+				strcpy(k->level[i], from[i]);
+		else
+			return fail(line, "not ramp steps levels... or hold steps", w[0]);
+		if (!steps(w[1], g, k->steps, line))
+			return 0;
+		++nKeys[g];
+	}
+	for (g = 0; g < GROUPS; ++g)
+		if (!nKeys[g]) {
+			fprintf(stderr, "%s: group %s has no ramp or hold\n", showPath,
+					groups[g].name);
+			return 0;
+		}
+	return 1;
+}
+
+static void write_header(FILE *f) {
+	char (*from)[EXPR_LEN];
+	int total = 0, g, k, i;
+	key *p;
+
+	for (g = 0; g < GROUPS; ++g)
+		total += nKeys[g];
+	fprintf(f, "//*********************************************************"
+			"*********************\n");
+	fprintf(f, "//\tShow of main.c for GEN_SHOW, generated by host/showc.c from "
+			"%s,\n//\tdo not edit.\n//\n", showPath);
+	fprintf(f, "//\t%d keys, %d bytes of flash\n", total, 4 * total);
+	fprintf(f, "//*********************************************************"
+			"*********************\n\n");
+	fprintf(f, "#ifndef SHOW_H\n#define SHOW_H\n\n");
+
+	for (g = 0; g < GROUPS; ++g)
+		for (i = 0; i < groups[g].n; ++i)
+			fprintf(f, "#define REQ_CH_%d\t\t%s\n", groups[g].first + i,
+					start[g][i]);
+	fprintf(f, "\n");
+	for (g = 0, total = 0; g < GROUPS; ++g) {
+		fprintf(f, "#define SHOW_BEGIN_%s\t%d\n", groups[g].name, total);
+		total += nKeys[g];
+	}
+	fprintf(f, "#define SHOW_END\t\t%d\n\n", total);
+
+	fprintf(f, "#define SHOW_KEYS\t\t/* Steps, increment of each channel */ "
+			"\\\n");
+	for (g = 0; g < GROUPS; ++g)
+		for (k = 0; k < nKeys[g]; ++k) {
+			p = &keys[g][k];
+			from = k ? keys[g][k - 1].level : start[g];
+			fprintf(f, "\t/* %s:%d */ \\\n\t{ %s", showPath, p->line,
+					p->steps);
+			for (i = 0; i < 3; ++i)
+				if (i >= groups[g].n)
+					fprintf(f, ", 0");
+				else if (!strcmp(from[i], p->level[i]))
+					fprintf(f, ", 0");
+				else
+					fprintf(f, ", SHOW_INC(%s, %s, %s)", from[i],
+							p->level[i], p->steps);
+			fprintf(f, " }, \\\n");
+		}
+	fprintf(f, "\n");
+
+	for (g = 0; g < GROUPS; ++g)
+		for (k = 0; k <= nKeys[g]; ++k) {
+			p = &keys[g][k < nKeys[g] ? k : nKeys[g] - 1];
+			from = k ? keys[g][k - 1].level : start[g];
+			for (i = 0; i < groups[g].n; ++i) {
+				if (k == nKeys[g]) {		// Back to the start
+					if (strcmp(p->level[i], start[g][i]))
+						fprintf(f, "#if (%s) != (%s)\n#error \"%s:%d: group %s "
+								"ends on other levels than it starts\"\n"
+								"#endif\n", p->level[i], start[g][i], showPath,
+								p->line, groups[g].name);
+					continue;
+				}
+				if (isdigit((unsigned char)*p->level[i]) &&
+						strcmp(p->level[i], "0"))
+					fprintf(f, "#if %s > MAX_CH_%s\n#error \"%s:%d: level %s "
+							"over MAX_CH_%s\"\n#endif\n", p->level[i],
+							groups[g].name, showPath, p->line, p->level[i],
+							groups[g].name);
+				if (strcmp(from[i], p->level[i]))
+					fprintf(f, "#if ((%s) - (%s)) %% (%s)\n#error \"%s:%d: ramp "
+							"of channel %d is not a whole number of levels per "
+							"step\"\n#endif\n", p->level[i], from[i], p->steps,
+							showPath, p->line, groups[g].first + i);
+			}
+		}
+	for (g = 0; g < GROUPS; ++g)
+		for (i = 0; i < groups[g].n; ++i)
+			if (isdigit((unsigned char)*start[g][i]) && strcmp(start[g][i], "0"))
+				fprintf(f, "#if %s > MAX_CH_%s\n#error \"%s:%d: level %s over "
+						"MAX_CH_%s\"\n#endif\n", start[g][i], groups[g].name,
+						showPath, startLine[g], start[g][i], groups[g].name);
+	fprintf(f, "\n#endif\n");
+}
+
+int main(int argc, char **argv) {
+	const char *path = "show.h";
+	FILE *f;
+	int opt, g, total = 0;
+
+	while ((opt = getopt(argc, argv, "o:")) != -1) {
+		if (opt == 'o')
+			path = optarg;
+		else
+			optind = argc + 1;
+	}
+	if (optind < argc - 1 || optind > argc) {
+		fprintf(stderr, "usage: showc [-o header] [show]\n");
+		return 2;
+	}
+	if (optind < argc)
+		showPath = argv[optind];
+	if (!(f = fopen(showPath, "r"))) {
+		perror(showPath);
+		return 2;
+	}
+	if (!read_show(f))
+		return 1;
+	fclose(f);
+	for (g = 0; g < GROUPS; ++g)
+		total += nKeys[g];
+	if (total > MAX_KEYS) {
+		fprintf(stderr, "%s: %d keys, at most %d\n", showPath, total, MAX_KEYS);
+		return 1;
+	}
+
+	if (!(f = fopen(path, "w"))) {
+		perror(path);
+		return 2;
+	}
+	write_header(f);
+	fclose(f);
+	for (g = 0; g < GROUPS; ++g)
+		printf("group %s: %d keys\n", groups[g].name, nKeys[g]);
+	printf("%d bytes of flash, %s written\n", 4 * total, path);
+	return 0;
+}
@@ -0,0 +1,682 @@
+//******************************************************************************
+//	Host simulator for the MSP430G2211 firmware in main.c
+//
+//	Description:
+//		Event loop, peripheral registers and coroutine glue, see sim.h.
+//
+//		Interrupt flags are set by events (WDT tick, pin edge, compare
+//		match) and served one at a time, highest priority first, once the
+//		CPU has finished the previous ISR. P1 pins are open drain aware:
+//		the level is the AND of what the firmware and the outside drive.
+//
+//		Cycle figures below are estimates counted from the C source at
+//		roughly one MSP430 instruction per 1-5 cycles, including the 6
+//		cycles of interrupt entry and the 5 of RETI. They are meant to be
+//		pessimistic; check them against the target before relying on a
+//		small margin. sim_profile() prints where they add up.
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+//------------------------------------------------------------------------------
+// Estimated MSP430 cycle costs
+//------------------------------------------------------------------------------
+#if SPREAD_TICK
+#define CYC_WDT_ISR		55		// Timer_A0(): as Watchdog_Timer(), LCG, TACCR0
+#else
+#define CYC_WDT_ISR		40		// Watchdog_Timer(): 2 port writes, count, wake
+#endif
+#define CYC_TA1_BIT		40		// Timer_A1(): start bit capture or data bit
+#define CYC_TA1_ISR		160		// Timer_A1(): stop bit, worst of uart_rx() and
+								//   frame_rx(), told apart by going back to
+								//   capture mode
+#define CYC_P1_ISR		110		// Port_1(): worst path, byte end + i2c_write()
+#define CYC_MAIN		720		// One main loop pass with the envelopes
+#define CYC_COMMIT		150		// Main loop woken by an ISR, frame_commit()
+
+#if SD_ADC						// Options add to every main loop pass
+#define CYC_ADC			70		// calc_adc(): conversion done path
+#else
+#define CYC_ADC			0
+#endif
+#if AMBIENT_DIM || CAP_TOUCH
+#define CYC_DIM			40		// Blanking, calc_dim() on a conversion
+#else
+#define CYC_DIM			0
+#endif
+#if CAP_TOUCH
+#define CYC_TOUCH		80		// calc_touch(): brightness step path
+#else
+#define CYC_TOUCH		0
+#endif
+#if FLASH_CFG
+#define CYC_CFG			40		// cfg_step(): next record byte
+#else
+#define CYC_CFG			0
+#endif
+#if DITHER
+#define CYC_DITHER		80		// calc_output_bits(): LFSR step per channel
+#else
+#define CYC_DITHER		0
+#endif
+#if SWITCH_LIMIT
+#define CYC_LIMIT		150		// limit_switching(): count, hold in turn
+#else
+#define CYC_LIMIT		0
+#endif
+#define CYC_PASS		(CYC_MAIN + CYC_ADC + CYC_DIM + CYC_TOUCH + CYC_CFG + \
+							CYC_DITHER + CYC_LIMIT + cycMod)
+
+#define CYC_FLASH_WRT	1200	// Byte program, 30 flash clocks at MCLK / 40
+#define CYC_FLASH_ERASE	192760	// Segment erase, 4819 flash clocks
+
+#define FW_STACK		(256 * 1024)
+
+//------------------------------------------------------------------------------
+// Analog front end of the delta-sigma ADC (see SD_ADC in main.c): a capacitor
+// on CA4 (P1.4) fed through equal resistors from P1.5 and the analog input
+//------------------------------------------------------------------------------
+#define ADC_TAU			(100e3 * 1e-6 * SIM_SMCLK)	// R*C in cycles
+
+//------------------------------------------------------------------------------
+// Touch pad on P1.1 (see CAP_TOUCH in main.c), discharged by the pull-down
+//------------------------------------------------------------------------------
+#define TOUCH_R			35e3	// Internal pull-down resistor
+#define TOUCH_C			15e-12	// Pad and trace
+#define TOUCH_FINGER	10e-12	// Added by a finger on the pad
+#define TOUCH_VIL		0.45	// Falling input threshold, fraction of Vcc
+
+//------------------------------------------------------------------------------
+// Flicker metric: the light of each LED through the eye, modelled as three
+// first-order low-pass stages; the eye is most sensitive to flicker below
+// ~20 Hz and fuses it above ~60 Hz (30 dB down here). What a steady level
+// still shows after them is its flicker, see sim_flicker().
+//------------------------------------------------------------------------------
+#define EYE_HZ			20		// Corner of each stage
+#define EYE_STAGES		3
+
+//------------------------------------------------------------------------------
+// Profiler sources, estimated cycles each time they run
+//------------------------------------------------------------------------------
+enum { PROF_WDT, PROF_TA1, PROF_P1, PROF_TA1_BIT, PROF_COMMIT, PROF_FLASH,
+		PROF_MAIN, PROF_ADC, PROF_DIM, PROF_TOUCH, PROF_CFG, PROF_DITHER,
+		PROF_LIMIT, PROF_MOD, PROF_N };
+static const char *const profName[PROF_N] = {
+#if SPREAD_TICK
+		"Timer_A0() tick",
+#else
+		"Watchdog_Timer()",
+#endif
+		"Timer_A1() stop bit", "Port_1()", "Timer_A1() other bit",
+		"main loop, commit only", "flash byte (CPU held)", "main loop pass",
+		"  calc_adc()", "  blanking, calc_dim()", "  calc_touch()",
+		"  cfg_step()", "  dither", "  limit_switching()",
+		"  modulation policies" };
+static unsigned int profCyc[PROF_N] = { CYC_WDT_ISR, CYC_TA1_ISR,
+		CYC_P1_ISR, CYC_TA1_BIT, CYC_COMMIT, CYC_FLASH_WRT, CYC_MAIN, CYC_ADC,
+		CYC_DIM, CYC_TOUCH, CYC_CFG, CYC_DITHER, CYC_LIMIT };
+static unsigned int cycMod;		// PROF_MOD, from the policy of each channel
+
+//------------------------------------------------------------------------------
+// Modulation policies of main.c (MOD_DS1 ... MOD_BAM), the calc_output_bits()
+// cycles each adds per channel to the first-order loop
+//------------------------------------------------------------------------------
+const char *const simModName[] = { "", "DS1", "DS2", "PWM", "PDM", "BAM" };
+const unsigned int simModCycles[] = { 0, 0, 25, 5, 15, 10 };
+
+//------------------------------------------------------------------------------
+// Peripheral registers (see msp430g2211.h)
+//------------------------------------------------------------------------------
+unsigned char IE1, IFG1;
+unsigned int WDTCTL;
+unsigned char DCOCTL, BCSCTL1, BCSCTL2, BCSCTL3;
+unsigned char P1IN, P1OUT, P1IFG, P1IES, P1IE, P1SEL, P1REN;
+unsigned char P2IN, P2OUT, P2DIR, P2IFG, P2IES, P2IE, P2SEL, P2REN;
+unsigned int TACTL, TAR, TAIV;
+unsigned int TACCTL0, TACCTL1, TACCR0, TACCR1;
+unsigned char CACTL1, CAPD;
+static unsigned char caCtl2;	// CACTL2
+unsigned int FCTL2;
+static unsigned int fctl1, fctl3 = FWKEY + LOCK + LOCKA;	// FCTL1, FCTL3
+unsigned char simInfo[256] = {	// Erased, segment A holds calibration data
+	[0 ... 191] = 0xFF, [192 ... 255] = 0x5A };
+static unsigned char infoWas[256];	// simInfo after the last flash access
+
+//------------------------------------------------------------------------------
+// Firmware entry points, the optional ones are only linked when enabled
+//------------------------------------------------------------------------------
+void fw_main(void);
+void Watchdog_Timer(void);
+void Timer_A0(void) __attribute__((weak));	// The tick with SPREAD_TICK
+void Timer_A1(void) __attribute__((weak));
+void Port_1(void) __attribute__((weak));
+
+extern const unsigned char fwAnode1, fwAnode2;
+
+//------------------------------------------------------------------------------
+// Simulator state
+//------------------------------------------------------------------------------
+sim_time simNow;
+unsigned long simTicks;
+unsigned long simMissed;
+unsigned int simLatency;
+unsigned int simFrame;
+void (*simHook)(void);
+sim_time (*simDevice)(sim_time t);
+sim_time simDeviceAt;
+double simAnalogIn;
+double simTouch;
+unsigned long simFlashWrites;
+unsigned long simFlashErases;
+unsigned long simFlashErrors;
+sim_time simBoot;
+unsigned long simBusiest;
+
+static ucontext_t simCtx, fwCtx;
+static int fwGie;				// GIE bit of the firmware
+static int fwWake;				// An ISR cleared the LPM0 bits
+static int mainPending;			// Main loop woken, its pass runs at mainEnd
+static int mainCommit;			// Woken by another ISR than the WDT, no tick
+
+static sim_time isrEnd;			// CPU busy with an ISR until then
+static sim_time mainEnd;		// Main loop pass done (back in LPM0) at
+static sim_time nextTick;		// Next WDT interrupt
+static sim_time ccr1At;			// Next TACCR1 compare match, 0 = none
+static sim_time wdtAt, ta1At, p1At;	// When each interrupt flag was raised
+
+static unsigned char p1Ext = 0xFF;	// Driven from outside, 1 = released
+static double capV = 0.5;		// Voltage on CA4, fraction of Vcc
+static sim_time capAt;			// Time of capV
+static unsigned char p1Dir;		// P1DIR
+static unsigned char p1DirSeen;	// Every P1DIR bit set during this ISR
+static unsigned char p1Held;	// Pins held low by the ISR until isrEnd
+
+static unsigned long profRuns[PROF_N];	// Times each source ran
+static double eye[16][EYE_STAGES];	// Low-pass stages per channel
+static double eyeSum[16], eyeSq[16];	// Of the last stage since clearing
+static unsigned long eyeTicks;
+static unsigned long tickBusy;	// Cycles charged since the last WDT tick
+static sim_time flashBusy;		// CPU held by the flash since the last pass
+
+static struct { sim_time t; unsigned char pin, level; } edges[SIM_EDGES];
+static unsigned int edgeHead, edgeTail;
+
+//------------------------------------------------------------------------------
+// Intrinsics used by the firmware
+//------------------------------------------------------------------------------
+void sim_lpm0(void) {
+	swapcontext(&fwCtx, &simCtx);	// Back to the event loop until woken
+}
+
+void sim_wake(void) {
+	fwWake = 1;
+}
+
+void sim_gie(int on) {
+	fwGie = on;
+}
+
+unsigned char *sim_p1dir(void) {
+	p1DirSeen |= p1Dir;
+	return &p1Dir;
+}
+
+static void fw_entry(void) {
+	fw_main();						// Never returns
+}
+
+//------------------------------------------------------------------------------
+// Timer_A
+//------------------------------------------------------------------------------
+static unsigned int ta_count(sim_time t) {
+	if ((TACTL & MC_2) == 0)
+		return TAR;					// Stopped (up mode is not modelled)
+	return (unsigned int)(t & 0xFFFF);	// Continuous, cleared at reset
+}
+
+static void ta_arm(sim_time t) {
+//	Recompute the next TACCR1 compare match if the firmware touched it at t;
+//	with SPREAD_TICK the TACCR0 match is the next tick
+	static unsigned int ctl, ccr;
+	unsigned int d;
+
+#if SPREAD_TICK
+	if ((TACTL & MC_2) && !(TACCTL0 & CAP)) {
+		d = (TACCR0 - ta_count(t)) & 0xFFFF;
+		nextTick = t + (d ? d : 0x10000);
+	}
+#endif
+	if (ccr1At && (TACCTL1 & ~(SCCI + CCI + CCIFG)) == ctl && TACCR1 == ccr)
+		return;						// Unchanged, match already scheduled
+	ctl = TACCTL1 & ~(SCCI + CCI + CCIFG);
+	ccr = TACCR1;
+	ccr1At = 0;
+	if ((TACTL & MC_2) && !(TACCTL1 & CAP)) {
+		d = (TACCR1 - ta_count(t)) & 0xFFFF;
+		ccr1At = t + (d ? d : 0x10000);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Comparator_A+ and the RC node on CA4
+//------------------------------------------------------------------------------
+static void cap_advance(sim_time t) {
+//	Exact RC step since capAt, P1.5 held at its current level meanwhile
+	double vEnd = (simAnalogIn + ((P1IN & BIT5) ? 1.0 : 0.0)) / 2;
+
+	capV = vEnd + (capV - vEnd) * exp(-2.0 * (t - capAt) / ADC_TAU);
+	capAt = t;
+}
+
+unsigned char *sim_cactl2(void) {
+//	Only the set-up of init_adc() is modelled: reference on +, CA4 on -
+	double ref = (CACTL1 & CAREF_3) == CAREF_1 ? 0.25 : 0.5;
+
+	cap_advance(simNow);
+	caCtl2 &= ~CAOUT;
+	if ((CACTL1 & CAON) && ref > capV)
+		caCtl2 |= CAOUT;
+	return &caCtl2;
+}
+
+//------------------------------------------------------------------------------
+// Flash controller and information memory
+//------------------------------------------------------------------------------
+unsigned int *sim_fctl(int n) {
+//	Apply the stores into simInfo since the last FCTL1 or FCTL3 access: with
+//	WRT they are programmed (bits only go from 1 to 0), with ERASE their
+//	segment is erased. Stores while locked, or in neither mode, are errors
+//	and undone. Each operation holds the CPU, see flashBusy.
+	int i;
+
+	for (i = 0; i < 256; ++i) {
+		if (simInfo[i] == infoWas[i])
+			continue;
+		if ((fctl3 & LOCK) || (i >= 192 && (fctl3 & LOCKA)) ||
+				!(fctl1 & (WRT + ERASE)) || (FCTL2 & 0x3F) < 33) {
+			++simFlashErrors;		// Or a flash clock above 476 kHz
+			simInfo[i] = infoWas[i];
+		}
+		else if (fctl1 & ERASE) {
+			memset(simInfo + (i & ~63), 0xFF, 64);
+			memset(infoWas + (i & ~63), 0xFF, 64);
+			fctl1 &= ~ERASE;		// Cleared when done
+			++simFlashErases;
+			flashBusy += CYC_FLASH_ERASE;
+		}
+		else {
+			simInfo[i] &= infoWas[i];
+			infoWas[i] = simInfo[i];
+			++simFlashWrites;
+			++profRuns[PROF_FLASH];
+			tickBusy += CYC_FLASH_WRT;
+			flashBusy += CYC_FLASH_WRT;
+		}
+	}
+	return n == 1 ? &fctl1 : &fctl3;
+}
+
+//------------------------------------------------------------------------------
+// Touch pad
+//------------------------------------------------------------------------------
+static void pad_release(sim_time t, unsigned char released) {
+//	P1.1 driven high as TA0.0 and released: capture when the pull-down has
+//	discharged it. Jitter of up to one cycle stands for the DCO.
+	double fall;
+
+	if (!(released & BIT1) || !(P1SEL & BIT1) || !(P1REN & BIT1) ||
+			(P1OUT & BIT1) || !(TACCTL0 & OUT) || !(TACCTL0 & CAP) ||
+			!(TACCTL0 & CM_2) || !(TACTL & MC_2))
+		return;
+	fall = TOUCH_R * (TOUCH_C + simTouch * TOUCH_FINGER) * SIM_SMCLK *
+			log(1 / TOUCH_VIL);
+	if (TACCTL0 & CCIFG)
+		TACCTL0 |= COV;
+	TACCR0 = ta_count(t + (sim_time)(fall + (double)rand() / RAND_MAX));
+	TACCTL0 |= CCIFG;				// The firmware reads it next tick
+}
+
+//------------------------------------------------------------------------------
+// Port 1 pins
+//------------------------------------------------------------------------------
+static void pins_update(sim_time t) {
+//	Recompute P1IN after either side changed a pin, raise the edge flags
+	unsigned char drive = (p1Dir | p1Held) & ~P1SEL;
+	unsigned char line = ((P1OUT & drive) | ~drive) & p1Ext;
+	unsigned char rise = (line ^ P1IN) & line;
+	unsigned char fall = (line ^ P1IN) & ~line;
+	unsigned int cm = TACCTL1 & CM_3;
+
+	if ((line ^ P1IN) & BIT5)
+		cap_advance(t);				// RC node saw the old P1.5 level so far
+	P1IN = line;
+	if (!(P1IFG & P1IE))
+		p1At = t;
+	P1IFG |= (rise & ~P1IES) | (fall & P1IES);
+
+	if ((P1SEL & BIT2) && (TACCTL1 & CAP) &&			// CCI1A capture
+			(((rise & BIT2) && (cm & CM_1)) || ((fall & BIT2) && (cm & CM_2)))) {
+		TACCR1 = ta_count(t);		// Captured at the edge, not at the ISR
+		if (!(TACCTL1 & CCIFG))
+			ta1At = t;
+		TACCTL1 |= CCIFG;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Interrupts, highest priority first
+//------------------------------------------------------------------------------
+static int irq_next(sim_time *at) {
+//	Pending and enabled interrupt to serve next, -1 if none
+	sim_time t[3];
+	int n, best = -1;
+
+	if (!fwGie)
+		return -1;
+#if SPREAD_TICK
+	t[0] = (TACCTL0 & CCIFG) && (TACCTL0 & CCIE) ? wdtAt : ~0ULL;
+#else
+	t[0] = (IFG1 & WDTIFG) && (IE1 & WDTIE) ? wdtAt : ~0ULL;
+#endif
+	t[1] = (TACCTL1 & CCIFG) && (TACCTL1 & CCIE) ? ta1At : ~0ULL;
+	t[2] = (P1IFG & P1IE) ? p1At : ~0ULL;
+	for (n = 0; n < 3; ++n) {
+		if (t[n] == ~0ULL)
+			continue;
+		if (t[n] < isrEnd)
+			t[n] = isrEnd;			// Requested while the CPU was busy
+		if (best < 0 || t[n] < t[best])
+			best = n;
+	}
+	if (best >= 0)
+		*at = t[best];
+	return best;
+}
+
+static void eye_tick(void) {
+//	Each channel's output bit through the eye model
+	static double a;
+	double x;
+	int n, k;
+
+	if (!a)
+		a = 1 - exp(-2 * M_PI * EYE_HZ * SIM_TICK / SIM_SMCLK);
+	for (n = 0; n < 16; ++n) {
+		x = (simFrame >> n) & 1;
+		for (k = 0; k < EYE_STAGES; ++k)
+			x = eye[n][k] += a * (x - eye[n][k]);
+		eyeSum[n] += x;
+		eyeSq[n] += x * x;
+	}
+	++eyeTicks;
+}
+
+static void irq_serve(int n, sim_time s) {
+	unsigned int cost, ctl = TACCTL1;
+
+	simNow = s;
+	TAR = ta_count(s);
+	p1DirSeen = p1Dir;
+	if (n == 0) {
+#if SPREAD_TICK
+		TACCTL0 &= ~CCIFG;			// Cleared by its own vector
+		Timer_A0();
+#else
+		IFG1 &= ~WDTIFG;
+		Watchdog_Timer();
+#endif
+		cost = CYC_WDT_ISR;
+		if (s - wdtAt > simLatency)
+			simLatency = (unsigned int)(s - wdtAt);
+		simFrame = ((P1OUT & p1Dir) ^ fwAnode1) |
+					((((P2OUT & P2DIR) ^ fwAnode2) & 0xC0) << 2);
+		eye_tick();
+	}
+	else if (n == 1) {
+		TACCTL1 &= ~CCIFG;
+		TAIV = TAIV_TACCR1;
+		if (Timer_A1)
+			Timer_A1();
+		cost = CYC_TA1_ISR;
+		if ((ctl & CAP) || !(TACCTL1 & CAP)) {
+			cost = CYC_TA1_BIT;		// Not the stop bit
+			n = PROF_TA1_BIT;
+		}
+	}
+	else {
+		if (Port_1)
+			Port_1();
+		else
+			P1IFG = 0;
+		cost = CYC_P1_ISR;
+	}
+	++profRuns[PROF_WDT + n];
+	tickBusy += cost;
+
+	isrEnd = s + cost;
+	if (mainPending)
+		mainEnd += cost;			// Main loop was preempted
+	p1Held = (p1DirSeen | p1Dir) & ~p1Dir & ~P1OUT;	// Pulled low, released
+	pins_update(s);					//   again at the end (see sim_run)
+	ta_arm(s);
+
+	if (fwWake && !mainPending) {	// Lost if the main loop was busy
+		mainPending = 1;
+		mainCommit = n != 0;
+		mainEnd = isrEnd + (mainCommit ? CYC_COMMIT : CYC_PASS);
+	}
+	else if (n == 0 && mainCommit) {
+		mainCommit = 0;				// Tick during a commit, the pass follows
+		mainEnd += CYC_PASS;
+	}
+	fwWake = 0;
+
+	if (simHook)
+		simHook();
+}
+
+//------------------------------------------------------------------------------
+// Public functions
+//------------------------------------------------------------------------------
+void sim_reset(void) {
+	static char *stack;
+	int n;
+
+	if (!stack)
+		stack = calloc(1, FW_STACK);
+	getcontext(&fwCtx);
+	fwCtx.uc_stack.ss_sp = stack;
+	fwCtx.uc_stack.ss_size = FW_STACK;
+	fwCtx.uc_link = NULL;
+	makecontext(&fwCtx, fw_entry, 0);
+
+	P1IN = p1Ext;
+	memcpy(infoWas, simInfo, sizeof(infoWas));	// As left by the last run
+	swapcontext(&simCtx, &fwCtx);	// Run main() up to its first LPM0
+	simBoot = flashBusy;			// Not on the time line, ticks start later
+	flashBusy = 0;
+	tickBusy = 0;
+	profRuns[PROF_FLASH] = 0;
+	for (n = 0, cycMod = 0; n < fwChannels; ++n)
+		cycMod += simModCycles[fwMod[n]];
+	profCyc[PROF_MOD] = cycMod;
+	pins_update(0);
+	ta_arm(0);
+	nextTick = SIM_TICK;
+}
+
+void sim_run(unsigned long ticks) {
+	unsigned long end = simTicks + ticks;
+	sim_time t, s;
+	int n;
+
+	while (simTicks < end) {
+		t = nextTick;
+		if (edgeHead != edgeTail && edges[edgeTail].t < t)
+			t = edges[edgeTail].t;
+		if (ccr1At && ccr1At < t)
+			t = ccr1At;
+		if (simDevice && simDeviceAt && simDeviceAt < t)
+			t = simDeviceAt;
+		if (p1Held && isrEnd < t)
+			t = isrEnd;
+		if (mainPending && mainEnd < t)
+			t = mainEnd;
+
+		n = irq_next(&s);
+		if (n >= 0 && s < t) {		// Events at the same time go first
+			irq_serve(n, s);
+			continue;
+		}
+
+		simNow = t;
+		if (mainPending && mainEnd == t) {
+			TAR = ta_count(t);
+			p1DirSeen = p1Dir;
+			swapcontext(&simCtx, &fwCtx);	// One main loop pass
+			mainPending = 0;
+			if (mainCommit) {
+				++profRuns[PROF_COMMIT];
+				tickBusy += CYC_COMMIT;
+			}
+			else {
+				for (n = PROF_MAIN; n < PROF_N; ++n)
+					if (profCyc[n])
+						++profRuns[n];
+				tickBusy += CYC_PASS;
+			}
+			mainCommit = 0;
+			if (flashBusy) {		// Held at the end of the pass
+				isrEnd = (isrEnd > t ? isrEnd : t) + flashBusy;
+				flashBusy = 0;
+			}
+			pad_release(t, (p1DirSeen | p1Dir) & ~p1Dir);
+			pins_update(t);
+			ta_arm(t);
+			if (simHook)
+				simHook();
+		}
+		else if (p1Held && isrEnd == t) {
+			p1Held = 0;				// ISR done, stretched pins released
+			pins_update(t);
+		}
+		else if (ccr1At && ccr1At == t) {
+			if (P1IN & BIT2)		// SCCI latches CCI1A at the match
+				TACCTL1 |= SCCI;
+			else
+				TACCTL1 &= ~SCCI;
+			if (!(TACCTL1 & CCIFG))
+				ta1At = t;
+			TACCTL1 |= CCIFG;
+			ccr1At = t + 0x10000;	// Again after a wrap unless moved
+		}
+		else if (edgeHead != edgeTail && edges[edgeTail].t == t) {
+			if (edges[edgeTail].level)
+				p1Ext |= edges[edgeTail].pin;
+			else
+				p1Ext &= ~edges[edgeTail].pin;
+			edgeTail = (edgeTail + 1) & (SIM_EDGES - 1);
+			pins_update(t);
+		}
+		else if (simDevice && simDeviceAt == t)
+			simDeviceAt = simDevice(t);
+		else {
+			++simTicks;
+			if (tickBusy > simBusiest)
+				simBusiest = tickBusy;
+			tickBusy = 0;
+			if (mainPending && !mainCommit)
+				++simMissed;		// Main loop did not reach LPM0 in time
+#if SPREAD_TICK
+			if (!(TACCTL0 & CCIFG))
+				wdtAt = t;
+			TACCTL0 |= CCIFG;		// TACCR0 compare match
+			nextTick = t + 0x10000;	// Again after a wrap unless moved
+#else
+			if (!(IFG1 & WDTIFG))
+				wdtAt = t;
+			if (WDTCTL & WDTTMSEL)
+				IFG1 |= WDTIFG;
+			nextTick += SIM_TICK;
+#endif
+		}
+	}
+}
+
+void sim_profile(void) {
+//	Estimated CPU use per source since reset, and the busiest tick
+	unsigned long total = simTicks * SIM_TICK;
+	int n;
+
+	printf("%-24s %6s %10s %7s\n", "source", "cycles", "runs/tick", "CPU %");
+	for (n = 0; n < PROF_N; ++n)
+		if (profRuns[n])
+			printf("%-24s %6u %10.3f %7.2f\n", profName[n], profCyc[n],
+					(double)profRuns[n] / simTicks,
+					100.0 * profRuns[n] * profCyc[n] / total);
+	printf("busiest tick: %lu of %lu cycles (%.1f%%)\n", simBusiest, SIM_TICK,
+			100.0 * simBusiest / SIM_TICK);
+}
+
+void sim_flicker_clear(void) {
+	int n;
+
+	for (n = 0; n < 16; ++n)
+		eyeSum[n] = eyeSq[n] = 0;
+	eyeTicks = 0;
+}
+
+double sim_flicker(int n) {
+//	RMS of the light of channel n as the eye sees it, around its mean, since
+//	sim_flicker_clear(); fraction of full brightness
+	double mean, var;
+
+	if (!eyeTicks)
+		return 0;
+	mean = eyeSum[n] / eyeTicks;
+	var = eyeSq[n] / eyeTicks - mean * mean;
+	return var > 0 ? sqrt(var) : 0;
+}
+
+int sim_pin(unsigned char pin) {
+	return (P1IN & pin) != 0;
+}
+
+void sim_drive(unsigned char pin, int level) {
+//	Drive a P1 pin from outside right now, 1 = release to the pull-up
+	if (level)
+		p1Ext |= pin;
+	else
+		p1Ext &= ~pin;
+	pins_update(simNow);
+}
+
+void sim_edge(sim_time t, unsigned char pin, int level) {
+//	Queue an edge, times must not go backwards; a full queue is drained first
+	while (((edgeHead + 1) & (SIM_EDGES - 1)) == edgeTail)
+		sim_run(1);
+	edges[edgeHead].t = t;
+	edges[edgeHead].pin = pin;
+	edges[edgeHead].level = level;
+	edgeHead = (edgeHead + 1) & (SIM_EDGES - 1);
+}
+
+sim_time sim_uart_tx(sim_time t, unsigned char c, double bit,
+		unsigned char pin) {
+//	Queue one 8N1 char starting at t, return the end of its stop bit
+	int i, level, prev = 1;
+
+	for (i = 0; i < 10; ++i) {
+		level = i == 0 ? 0 : i == 9 ? 1 : (c >> (i - 1)) & 1;
+		if (level != prev)
+			sim_edge(t + (sim_time)(i * bit + 0.5), pin, level);
+		prev = level;
+	}
+	return t + (sim_time)(10 * bit + 0.5);
+}
@@ -0,0 +1,89 @@
+//******************************************************************************
+//	Host simulator for the MSP430G2211 firmware in main.c
+//
+//	Description:
+//		main.c is compiled unchanged for the PC (fw.c, msp430g2211.h) and its
+//		main() runs as a coroutine that yields on every LPM0. The simulator
+//		owns the peripheral registers and replays, in SMCLK cycles, the
+//		events that drive the firmware: WDT ticks, edges on input pins and
+//		Timer_A compare matches. Each event calls the matching ISR.
+//
+//		Input pins are driven either from a queue of timed edges (sim_edge)
+//		or by a device model (simDevice) that is called back at the times
+//		it asks for and can react to the firmware, e.g. an I2C master.
+//
+//		The MSP430 cycle cost of each ISR and of one main loop pass is taken
+//		from the estimates in sim.c. With them the simulator tracks how late
+//		every WDT tick is served and whether the main loop got back to LPM0
+//		before the next tick (otherwise that tick is counted as missed).
+//		A main loop pass runs on the host at the time it would end on the
+//		target, so ISRs that preempt it see the state they would see there.
+//
+//	Build: (from the repository root)
+//		gcc -O2 -Ihost -o sim_xxx host/fw.c host/sim.c host/sim_xxx.c -lm
+//		Firmware options are set with -D, e.g. -DSOFT_UART=1
+//******************************************************************************
+
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#define SIM_SMCLK		16000000UL	// DCO as set by main(), cycles per second
+#if GEN_CONFIG
+#include "../config.h"				// Tick and options as the firmware sees them
+#endif
+#ifndef TICK_CYCLES
+#define TICK_CYCLES		8192		// Same -D as the firmware
+#endif
+#define SIM_TICK		((unsigned long)TICK_CYCLES)	// SMCLK cycles per tick
+#define SIM_EDGES		4096		// Pending input edges, power of 2
+
+typedef unsigned long long sim_time;	// SMCLK cycles since reset
+
+//------------------------------------------------------------------------------
+// Simulator state and statistics
+//------------------------------------------------------------------------------
+extern sim_time simNow;				// Time of the event being processed
+extern unsigned long simTicks;		// WDT ticks served
+extern unsigned long simMissed;		// Ticks that found the main loop busy
+extern unsigned int simLatency;		// Worst WDT ISR latency, cycles
+extern unsigned int simFrame;		// Channel bits output by the last tick
+extern void (*simHook)(void);		// Called after every ISR, may be NULL
+extern sim_time (*simDevice)(sim_time t);	// Returns its next call, 0 = none
+extern sim_time simDeviceAt;		// Next simDevice call, 0 = none
+extern double simAnalogIn;			// ADC input voltage, fraction of Vcc
+extern double simTouch;				// Finger on the touch pad, 0 ... 1
+extern unsigned char simInfo[256];	// Information memory, kept by sim_reset()
+extern unsigned long simFlashWrites;	// Flash bytes programmed
+extern unsigned long simFlashErases;	// Flash segments erased
+extern unsigned long simFlashErrors;	// Stores while locked, bad flash clock
+extern sim_time simBoot;			// CPU held by the flash before the 1st LPM0
+extern unsigned long simBusiest;	// Most cycles used between two ticks
+extern const char *const simModName[];	// Of MOD_DS1 ... MOD_BAM, by number
+extern const unsigned int simModCycles[];	// Added per channel, estimated
+
+//------------------------------------------------------------------------------
+// Firmware symbols (main.c)
+//------------------------------------------------------------------------------
+extern unsigned int max[];
+extern unsigned char req[];
+extern unsigned int sum[];
+extern unsigned char hostCtl;
+extern unsigned int tickCnt;
+extern unsigned char lateCnt, errCnt;
+extern const unsigned char fwChannels;	// N_CH
+extern const unsigned char fwMod[];	// Modulation policy of each channel
+
+//------------------------------------------------------------------------------
+// Simulator functions
+//------------------------------------------------------------------------------
+void sim_reset(void);				// Boot the firmware, once per process
+void sim_run(unsigned long ticks);	// Run until that many more ticks served
+void sim_edge(sim_time t, unsigned char pin, int level);	// Drive a P1 pin
+void sim_drive(unsigned char pin, int level);	// Same, now (from simDevice)
+int sim_pin(unsigned char pin);		// P1 pin level now
+sim_time sim_uart_tx(sim_time t, unsigned char c, double bit, unsigned char pin);
+void sim_profile(void);				// Print the estimated CPU use per source
+void sim_flicker_clear(void);		// Start a flicker measurement
+double sim_flicker(int n);			// RMS ripple of channel n seen by the eye
+
+#endif
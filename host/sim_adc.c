@@ -0,0 +1,64 @@
+//******************************************************************************
+//	Delta-sigma ADC check - Comparator_A+ loop against the RC model in sim.c
+//
+//	Description:
+//		Sweeps the analog input from 0 to Vcc. At each step the loop settles
+//		for a few conversions, then CONVS results are averaged. The worst
+//		deviation of the average from the ideal code is the linearity error,
+//		the worst standard deviation the noise, both in LSB of adcVal.
+//		The modulators keep running, so missed ticks show the cost of
+//		calc_adc() in the main loop.
+//
+//	Build:
+//		gcc -O2 -Ihost -DSD_ADC=1 -o sim_adc
+//			host/fw.c host/sim.c host/sim_adc.c -lm
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define OSR				128		// ADC_OSR in main.c
+#define STEPS			32		// Input steps over 0 ... Vcc
+#define SETTLE			3		// Conversions skipped after a step
+#define CONVS			16		// Conversions averaged per step
+#define MAX_ERR			3.0		// Linearity error allowed, LSB
+#define MAX_NOISE		1.0		// Noise allowed, LSB rms
+
+extern unsigned char adcVal;
+
+int main(void) {
+	double in, sum, sq, mean, sd, ideal, err = 0, noise = 0;
+	int s, i;
+
+	sim_reset();
+	sim_run(OSR * SETTLE);
+
+	for (s = 0; s <= STEPS; ++s) {
+		in = (double)s / STEPS;
+		simAnalogIn = in;
+		sim_run(OSR * SETTLE);
+		sum = sq = 0;
+		for (i = 0; i < CONVS; ++i) {
+			sim_run(OSR);
+			sum += adcVal;
+			sq += (double)adcVal * adcVal;
+		}
+		mean = sum / CONVS;
+		sd = sqrt(fmax(sq / CONVS - mean * mean, 0));
+		ideal = fmin(in * 256, 255);
+		printf("in %5.3f Vcc: adcVal %6.2f (ideal %6.2f), noise %4.2f LSB\n",
+				in, mean, ideal, sd);
+		err = fmax(err, fabs(mean - ideal));
+		noise = fmax(noise, sd);
+	}
+
+	printf("%lu ticks, %lu missed, WDT latency <= %u cycles, "
+			"error <= %.2f LSB, noise <= %.2f LSB, conversion %.1f ms\n",
+			simTicks, simMissed, simLatency, err, noise,
+			1e3 * OSR * SIM_TICK / SIM_SMCLK);
+	s = simMissed || err > MAX_ERR || noise > MAX_NOISE;
+	printf(s ? "FAIL\n" : "PASS\n");
+	return s;
+}
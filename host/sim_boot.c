@@ -0,0 +1,105 @@
+//******************************************************************************
+//	Cold start check - how soon after reset the outputs are right
+//
+//	Description:
+//		From reset on, every tick's output bit of each channel is added up
+//		and compared with the ideal lit time, the sum of 1 - req/max over
+//		the same ticks. A settled first-order modulator keeps this running
+//		error within +-1/2 tick; the first correct frame is the first tick
+//		from which every channel stays within that bound. A dark first
+//		frame or integrators starting at an edge show up as a later first
+//		correct frame and a larger error early on.
+//
+//		SWITCH_LIMIT lets a channel carry one tick of debt on top of that.
+//
+//		The envelopes run, and in a second run a host sets levels that are
+//		neither 0 nor max right after the first tick, so the integrators
+//		matter.
+//
+//	Build:
+//		gcc -O2 -Ihost -o sim_boot host/fw.c host/sim.c host/sim_boot.c -lm
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#ifndef SWITCH_LIMIT
+#define SWITCH_LIMIT	0		// Same -D as the firmware
+#endif
+
+#define TICKS			4096	// Ticks checked after reset
+#define BOUND			(SWITCH_LIMIT ? 1.5 : 0.5)	// Settled running error
+
+static double ideal[16], worst[16];
+static unsigned long lit[16], lastTicks, settled;
+static int host;				// 1 = a host sets levels after the first tick
+
+static void watch(void) {
+//------------------------------------------------------------------------------
+// simHook - running error of each channel, last tick it was out of bounds
+//------------------------------------------------------------------------------
+	double err;
+	int n, out = 0;
+
+	if (simTicks == lastTicks)
+		return;
+	lastTicks = simTicks;
+	for (n = 0; n < fwChannels; ++n) {
+		ideal[n] += 1.0 - (double)req[n] / max[n];
+		if (simFrame & (1 << n))
+			++lit[n];
+		err = fabs(lit[n] - ideal[n]);
+		if (err > worst[n])
+			worst[n] = err;
+		out |= err > BOUND + 1e-9;
+	}
+	if (out)
+		settled = simTicks + 1;
+	if (host && simTicks == 1) {	// Levels for the next modulator step
+		hostCtl = 1;
+		for (n = 0; n < fwChannels; ++n)
+			req[n] = max[n] * (n + 1) / (fwChannels + 1);
+	}
+}
+
+static void run(void) {
+//	One cold start, in its own process since the firmware boots once
+	double w = 0;
+	int n;
+
+	sim_reset();
+	settled = 1;
+	simHook = watch;
+	sim_run(TICKS);
+
+	for (n = 0; n < fwChannels; ++n)
+		if (worst[n] > w)
+			w = worst[n];
+	printf("%-12s first correct frame ", host ? "host levels:" : "envelopes:");
+	if (settled < TICKS)
+		printf("at tick %lu (%.2f ms after reset)", settled,
+				1e3 * settled * SIM_TICK / SIM_SMCLK);
+	else
+		printf("not within %d ticks", TICKS);
+	printf(", worst running error %.2f ticks\n", w);
+	exit(settled > 1 || w > BOUND + 1e-9 || simMissed);
+}
+
+int main(void) {
+	int status, fail = 0;
+
+	for (host = 0; host <= 1; ++host) {
+		fflush(stdout);
+		if (!fork())
+			run();
+		wait(&status);
+		fail |= !WIFEXITED(status) || WEXITSTATUS(status);
+	}
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
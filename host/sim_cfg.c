@@ -0,0 +1,255 @@
+//******************************************************************************
+//	Flash configuration check - settings across simulated power cycles
+//
+//	Description:
+//		Each boot runs in its own process; simInfo, the information memory,
+//		is handed from one boot to the next through a pipe.
+//
+//		First a blank chip: a resolution is set over the UART and the pad is
+//		tapped, then after a power cycle both must be back. Then a session
+//		with more changes than the slots erased at boot: the saves must stop
+//		when they run out, without an erase or a missed tick, and the next
+//		boot must load the last one saved. A max[] below MAX_CH_* has to
+//		be refused, not saved, and no request may pass max[] after it.
+//
+//		Then power is cut at a random byte of a record, 200 times. Every
+//		boot must load the last complete record. The worst boot time, the
+//		WDT latency a byte write adds and the erases per segment show the
+//		cost and the wear.
+//
+//	Build:
+//		gcc -O2 -Ihost -DFLASH_CFG=1 -DCAP_TOUCH=1 -DSOFT_UART=1 -o sim_cfg
+//			host/fw.c host/sim.c host/sim_cfg.c -lm
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define TICKS_MS(ms)	((unsigned long)(ms) * SIM_SMCLK / SIM_TICK / 1000)
+#define BAUD			115200
+#define RXD				BIT2
+#define SAVE_MS			2500	// CFG_DELAY and a record, one byte per tick
+#define REC_BYTES		14		// Bytes programmed per record (N_CH + 4)
+#define CUTS			200		// Power cuts inside a record
+#define SEG_BYTES		64
+#define CYC_WRITE		1500	// WDT latency allowed, a byte write and more
+
+extern unsigned char touchProg, touchDim, cfgLeft, cfgPos;
+
+static int toParent[2];
+static int cutVal;				// Value of max[0] written when power is cut
+static unsigned long erases[4];	// Per INFO segment, over all boots
+static unsigned char before[256];
+static sim_time worstBoot;		// Longest flash time at boot, cycles
+
+static void boot(void) {
+//	Power on with simInfo as left by the previous boot, autobaud, let the
+//	touch baseline settle
+	sim_edge(0, RXD, 1);
+	memcpy(before, simInfo, sizeof(before));
+	sim_reset();
+	if (simBoot > worstBoot)
+		worstBoot = simBoot;
+	sim_run(1);
+	sim_uart_tx(simNow + SIM_TICK / 3, 0x55, (double)SIM_SMCLK / BAUD, RXD);
+	sim_run(TICKS_MS(200));
+}
+
+static void set_max(int n, int val) {
+//	Host command 0xC0 + n, val
+	double bit = (double)SIM_SMCLK / BAUD;
+
+	sim_uart_tx(sim_uart_tx(simNow + SIM_TICK / 3, 0xC0 + n, bit, RXD), val,
+			bit, RXD);
+	sim_run(2);
+}
+
+static void tap(void) {
+	simTouch = 1;
+	sim_run(TICKS_MS(150));
+	simTouch = 0;
+	sim_run(TICKS_MS(50));
+}
+
+static void power_off(int fail, unsigned char result) {
+//	Hand the flash and a result byte to the parent; erases per segment
+	int g, n;
+
+	for (g = 0; g < 4; ++g)
+		for (n = 0; n < SEG_BYTES; ++n)
+			if (simInfo[g * SEG_BYTES + n] > before[g * SEG_BYTES + n]) {
+				++erases[g];		// Bits went from 0 to 1
+				break;
+			}
+	fail |= simFlashErrors || simMissed || lateCnt || errCnt;
+	if (write(toParent[1], simInfo, 256) != 256 ||
+			write(toParent[1], erases, sizeof(erases)) != sizeof(erases) ||
+			write(toParent[1], &worstBoot, sizeof(worstBoot)) !=
+				sizeof(worstBoot) ||
+			write(toParent[1], &result, 1) != 1)
+		fail = 1;
+	exit(fail);
+}
+
+static int run(void (*session)(int), int arg, unsigned char *result) {
+//	One boot in a child process, 1 if it failed
+	int status, fail;
+
+	fflush(stdout);
+	if (pipe(toParent))
+		return 1;
+	if (!fork())
+		session(arg);
+	close(toParent[1]);
+	fail = read(toParent[0], simInfo, 256) != 256 ||
+			read(toParent[0], erases, sizeof(erases)) != sizeof(erases) ||
+			read(toParent[0], &worstBoot, sizeof(worstBoot)) !=
+				sizeof(worstBoot) ||
+			read(toParent[0], result, 1) != 1;
+	close(toParent[0]);
+	wait(&status);
+	return fail || !WIFEXITED(status) || WEXITSTATUS(status);
+}
+
+static void fresh(int arg) {
+//------------------------------------------------------------------------------
+// Blank chip: defaults, then a resolution and a program to keep
+//------------------------------------------------------------------------------
+	int fail;
+
+	(void)arg;						// Only the other scenarios take one
+
+	boot();
+	fail = max[2] != 200 || touchProg != 0;
+	printf("blank chip:   max[2] %3u, program %u, boot %4.1f ms, "
+			"%lu erases %s\n", max[2], touchProg, 1e3 * simBoot / SIM_SMCLK,
+			simFlashErases, fail ? "WRONG" : "ok");
+	set_max(2, 250);
+	tap();
+	sim_run(TICKS_MS(SAVE_MS));
+	printf("              max[2] %3u, program %u saved, %lu bytes written\n",
+			max[2], touchProg, simFlashWrites);
+	power_off(fail || simFlashWrites != REC_BYTES, 0);
+}
+
+static void reload(int changes) {
+//------------------------------------------------------------------------------
+// Settings back after a power cycle, then more changes than free slots
+//------------------------------------------------------------------------------
+	unsigned char left, prog = 1;
+	unsigned long e0;
+	int i, fail;
+
+	boot();
+	fail = max[2] != 250 || touchProg != prog;
+	printf("power cycle:  max[2] %3u, program %u, boot %4.1f ms, "
+			"%lu erases, %u slots free %s\n", max[2], touchProg,
+			1e3 * simBoot / SIM_SMCLK, simFlashErases, cfgLeft,
+			fail ? "WRONG" : "ok");
+	left = cfgLeft;
+	e0 = simFlashErases;
+	for (i = 0; i < changes; ++i) {
+		tap();
+		if (cfgLeft)
+			prog = touchProg;		// Last one that will be saved
+		sim_run(TICKS_MS(SAVE_MS));
+	}
+	printf("              %d changes, %u saved, %lu runtime erases, "
+			"%lu missed, WDT latency <= %u cycles (%.0f us)\n", changes,
+			left - cfgLeft, simFlashErases - e0, simMissed, simLatency,
+			1e6 * simLatency / SIM_SMCLK);
+	sim_profile();
+	fail |= simFlashErases != e0 || cfgLeft || changes <= left;
+	fail |= simLatency > CYC_WRITE;
+	power_off(fail, prog);
+}
+
+static void check_prog(int prog) {
+	int fail;
+
+	boot();
+	fail = touchProg != prog || max[2] != 250;
+	printf("power cycle:  program %u (last saved %d), %u slots free %s\n",
+			touchProg, prog, cfgLeft, fail ? "WRONG" : "ok");
+	power_off(fail, 0);
+}
+
+static void low(int arg) {
+//------------------------------------------------------------------------------
+// max[1] = 50 from the host, below MAX_CH_0_2: refused, envelopes within max[]
+//------------------------------------------------------------------------------
+	unsigned long t, w0, over = 0;
+	unsigned char refused;
+	int n, fail;
+
+	(void)arg;						// Only the other scenarios take one
+
+	boot();
+	w0 = simFlashWrites;
+	set_max(1, 50);
+	refused = errCnt;
+	for (t = 0; t < TICKS_MS(SAVE_MS); ++t) {
+		sim_run(1);
+		for (n = 0; n < fwChannels; ++n)
+			over += req[n] > max[n];
+	}
+	fail = max[1] != 200 || refused != 1 || over || simFlashWrites != w0;
+	printf("low max:      max[1] %3u, %u refused, %lu requests above max, "
+			"%lu bytes written %s\n", max[1], refused, over,
+			simFlashWrites - w0, fail ? "WRONG" : "ok");
+	errCnt = 0;						// The refusal, counted above
+	power_off(fail, 0);
+}
+
+static void cut(int k) {
+//------------------------------------------------------------------------------
+// Boot, change max[0] to cutVal, cut the power after k record bytes. Found
+// by cfgPos, the byte written next, not by simFlashWrites, which misses a
+// byte of 0xFF (a sum can be one): positions 1 ... 12 are the first 12 bytes,
+// 13 and 14 are left erased, then the sum at 15 and the seq at 16.
+//------------------------------------------------------------------------------
+	unsigned char got, next;
+
+	next = k < REC_BYTES - 1 ? k + 1 : k == REC_BYTES - 1 ? REC_BYTES + 2 : 0;
+	boot();
+	got = max[0];
+	set_max(0, cutVal);
+	do
+		sim_run(1);
+	while (!cfgPos);
+	while (cfgPos != next)
+		sim_run(1);
+	power_off(0, got);
+}
+
+int main(void) {
+	unsigned char prog, got, want = 200;	// MAX_CH_0_2, not changed yet
+	unsigned long boots = 3;
+	int i, k, fail = 0, wrong = 0;
+
+	fail |= run(fresh, 0, &got);
+	fail |= run(reload, 12, &prog);
+	fail |= run(check_prog, prog, &got);
+	fail |= run(low, 0, &got);
+
+	for (i = 0; i < CUTS; ++i, ++boots) {
+		k = 1 + rand() % REC_BYTES;
+		cutVal = 200 + rand() % 56;	// MAX_CH_0_2 ... 255
+		fail |= run(cut, k, &got);
+		wrong += got != want;
+		if (k == REC_BYTES)
+			want = cutVal;			// Seq byte written, record complete
+	}
+	printf("%d power cuts inside a record: %d wrong loads; erases per "
+			"segment D %lu, C %lu, B %lu, A %lu in %lu boots; boot <= %.1f ms "
+			"of flash time\n", CUTS, wrong, erases[0], erases[1], erases[2],
+			erases[3], boots, 1e3 * worstBoot / SIM_SMCLK);
+	fail |= wrong || erases[3];
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
@@ -0,0 +1,286 @@
+//******************************************************************************
+//	Colour accuracy - CIE xyY and Delta E of each LED group over its envelope
+//
+//	Description:
+//		The firmware runs from reset for one full envelope cycle of the
+//		slowest group. On every tick three lit fractions of each channel go
+//		through the eye model of sim.c (EYE_STAGES low-pass stages at -f
+//		Hz, default 20), the window over which the eye averages:
+//			intended	the fade as meant, k * max / STEPS after k steps,
+//						tracked from the req[] steps of the envelopes
+//			req			1 - req/max, what the modulator is asked for
+//			output		the bits on the pins
+//		The lit fractions of a group, weighted with the chromaticity x, y
+//		and luminous intensity Y of each LED, add up to its colour in CIE
+//		XYZ, then L*a*b* with the group at full on as white (L* = 100).
+//		Three Delta E*ab (CIE76) are taken each tick:
+//			quantization	req against intended, the integer INC_CH_* =
+//							MAX / STEPS (zero when STEPS divides MAX)
+//			modulator		output against req, what the finite averaging
+//							of the bits by the eye leaves
+//			total			output against intended
+//		and reported per group as mean, max and % of ticks above a just
+//		noticeable difference (JND, 2.3), with the tick, its place in the
+//		envelope cycle and both colours (xyY) of the worst one.
+//
+//		The LED data is a typical 5 mm RGB and RG set; -c reads other data,
+//		one line per channel: "channel x y Y" (Y in any common unit, e.g.
+//		cd, # starts a comment). -o writes one CSV line per group and
+//		envelope step (every 2**LOOP_SPEED ticks) to find where the error
+//		is.
+//
+//	Build:
+//		gcc -O2 -Ihost -o sim_color host/fw.c host/sim.c host/sim_color.c -lm
+//	Run:
+//		./sim_color [-c leds] [-f eye Hz] [-o trace.csv]
+//		e.g. rebuilt with -DMAX_CH_8_9=255 -DSTEPS_CH_8_9=100 (INC 2, not
+//		2.55) for a quantization error
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define EYE_STAGES		3		// As sim.c
+#define JND				2.3		// Delta E*ab just noticeable
+#define N_GROUP			4
+#define N_DE			3		// Quantization, modulator, total
+#define N_SIG			3		// Intended, req, output
+
+extern const unsigned char fwInc[], fwSteps[], fwLoopSpeed;
+
+static const struct {
+	const char *name;
+	int first, n;				// Channels
+	int phases;					// Fades per envelope cycle
+} groups[N_GROUP] = {
+	{ "RGB_LED_1", 0, 3, 6 }, { "RGB_LED_2", 3, 3, 6 },
+	{ "RG_LED_1", 6, 2, 4 }, { "RG_LED_2", 8, 2, 4 } };
+
+static double led[16][3] = {	// x, y, Y of each channel's LED
+	{ 0.700, 0.299, 0.8 }, { 0.170, 0.700, 2.0 }, { 0.135, 0.040, 0.5 },
+	{ 0.700, 0.299, 0.8 }, { 0.170, 0.700, 2.0 }, { 0.135, 0.040, 0.5 },
+	{ 0.700, 0.299, 0.8 }, { 0.170, 0.700, 2.0 },
+	{ 0.700, 0.299, 0.8 }, { 0.170, 0.700, 2.0 } };
+
+static const char *const deName[N_DE] = { "quantization", "modulator",
+		"total" };
+
+static double eye[N_SIG][16][EYE_STAGES];	// Low-pass stages
+static double intended[16];		// Level the fade means, 0 ... max
+static unsigned char lastReq[16];
+static double white[N_GROUP][3];	// XYZ of each group at full on
+static unsigned long lastTicks, start;
+static double a;				// Eye stage coefficient
+
+static struct {
+	double sum, max;
+	unsigned long over;			// Ticks above JND
+	unsigned long at;			// Tick of the max
+	double want[3], got[3];		// xyY there
+} de[N_GROUP][N_DE];
+static FILE *trace;
+
+static void to_xyz(const double *lit, int g, double *xyz) {
+//	Colour of group g from the lit fraction of each of its channels
+	double *l;
+	int i, n;
+
+	xyz[0] = xyz[1] = xyz[2] = 0;
+	for (i = 0; i < groups[g].n; ++i) {
+		n = groups[g].first + i;
+		l = led[n];
+		xyz[0] += lit[n] * l[2] * l[0] / l[1];
+		xyz[1] += lit[n] * l[2];
+		xyz[2] += lit[n] * l[2] * (1 - l[0] - l[1]) / l[1];
+	}
+}
+
+static double lab_f(double t) {
+	return t > 216.0 / 24389 ? cbrt(t) : t * 841.0 / 108 + 4.0 / 29;
+}
+
+static void to_lab(const double *xyz, int g, double *lab) {
+	double fx = lab_f(xyz[0] / white[g][0]), fy = lab_f(xyz[1] / white[g][1]);
+	double fz = lab_f(xyz[2] / white[g][2]);
+
+	lab[0] = 116 * fy - 16;
+	lab[1] = 500 * (fx - fy);
+	lab[2] = 200 * (fy - fz);
+}
+
+static void to_xyy(const double *xyz, int g, double *xyy) {
+//	x, y and Y with the group at full on as Y = 100
+	double s = xyz[0] + xyz[1] + xyz[2];
+
+	xyy[0] = s > 0 ? xyz[0] / s : 0;
+	xyy[1] = s > 0 ? xyz[1] / s : 0;
+	xyy[2] = 100 * xyz[1] / white[g][1];
+}
+
+static void tick(void) {
+//------------------------------------------------------------------------------
+// simHook - once per tick: track the intended fade, filter the three lit
+// fractions of each channel, compare the colours of each group
+//------------------------------------------------------------------------------
+	double lit[N_SIG][16], xyz[N_SIG][3], lab[N_SIG][3], d[N_DE], x;
+	static const int pair[N_DE][2] = { { 1, 0 }, { 2, 1 }, { 2, 0 } };
+	int g, n, s, k, i;
+
+	if (simTicks == lastTicks)
+		return;
+	lastTicks = simTicks;
+	for (n = 0; n < fwChannels; ++n) {
+		if (req[n] != lastReq[n]) {
+			if (req[n] == lastReq[n] + fwInc[n])
+				intended[n] += (double)max[n] / fwSteps[n];
+			else if (req[n] == lastReq[n] - fwInc[n])
+				intended[n] -= (double)max[n] / fwSteps[n];
+			else
+				intended[n] = req[n];	// Not an envelope step, start over
+			lastReq[n] = req[n];
+		}
+		lit[0][n] = 1 - intended[n] / max[n];
+		lit[1][n] = 1 - (double)req[n] / max[n];
+		lit[2][n] = simFrame >> n & 1;
+		for (s = 0; s < N_SIG; ++s) {
+			x = lit[s][n];
+			for (k = 0; k < EYE_STAGES; ++k)
+				x = eye[s][n][k] += a * (x - eye[s][n][k]);
+			lit[s][n] = x;
+		}
+	}
+	if (simTicks < start)
+		return;
+
+	for (g = 0; g < N_GROUP; ++g) {
+		for (s = 0; s < N_SIG; ++s) {
+			to_xyz(lit[s], g, xyz[s]);
+			to_lab(xyz[s], g, lab[s]);
+		}
+		for (i = 0; i < N_DE; ++i) {
+			for (k = 0, d[i] = 0; k < 3; ++k)
+				d[i] += (lab[pair[i][0]][k] - lab[pair[i][1]][k]) *
+						(lab[pair[i][0]][k] - lab[pair[i][1]][k]);
+			d[i] = sqrt(d[i]);
+			de[g][i].sum += d[i];
+			de[g][i].over += d[i] > JND;
+			if (d[i] > de[g][i].max) {
+				de[g][i].max = d[i];
+				de[g][i].at = simTicks - start;
+				to_xyy(xyz[pair[i][1]], g, de[g][i].want);
+				to_xyy(xyz[pair[i][0]], g, de[g][i].got);
+			}
+		}
+		if (trace && !((simTicks - start) & ((1UL << fwLoopSpeed) - 1))) {
+			to_xyy(xyz[0], g, lab[0]);		// Reused for xyY
+			to_xyy(xyz[2], g, lab[2]);
+			fprintf(trace, "%lu,%s,%.4f,%.4f,%.2f,%.4f,%.4f,%.2f,%.2f,%.2f,"
+					"%.2f\n", simTicks - start, groups[g].name, lab[0][0],
+					lab[0][1], lab[0][2], lab[2][0], lab[2][1], lab[2][2],
+					d[0], d[1], d[2]);
+		}
+	}
+}
+
+static int read_leds(const char *path) {
+	char line[128];
+	double x, y, lum;
+	FILE *f = fopen(path, "r");
+	int n;
+
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof line, f)) {
+		line[strcspn(line, "#")] = 0;
+		if (sscanf(line, "%d %lf %lf %lf", &n, &x, &y, &lum) != 4)
+			continue;
+		if (n >= 0 && n < 16 && y > 0) {
+			led[n][0] = x;
+			led[n][1] = y;
+			led[n][2] = lum;
+		}
+	}
+	fclose(f);
+	return 1;
+}
+
+int main(int argc, char **argv) {
+	double eyeHz = 20, tickHz = (double)SIM_SMCLK / SIM_TICK, full[16], ticks;
+	unsigned long cycle = 0, c;
+	int opt, g, n, i, k;
+
+	while ((opt = getopt(argc, argv, "c:f:o:")) != -1) {
+		if (opt == 'c' && !read_leds(optarg)) {
+			perror(optarg);
+			return 2;
+		}
+		else if (opt == 'f')
+			eyeHz = atof(optarg);
+		else if (opt == 'o' && !(trace = fopen(optarg, "w"))) {
+			perror(optarg);
+			return 2;
+		}
+		else if (opt != 'c' && opt != 'f' && opt != 'o') {
+			fprintf(stderr, "usage: sim_color [-c leds] [-f eye Hz] "
+					"[-o trace.csv]\n");
+			return 2;
+		}
+	}
+	if (trace)
+		fprintf(trace, "tick,group,want_x,want_y,want_Y,got_x,got_y,got_Y,"
+				"de_quant,de_mod,de_total\n");
+	a = 1 - exp(-2 * M_PI * eyeHz / tickHz);
+
+	sim_reset();
+	for (n = 0; n < fwChannels; ++n) {
+		full[n] = 1;
+		lastReq[n] = req[n];
+		intended[n] = req[n];
+		for (i = 0; i < N_SIG; ++i)		// Settled on the reset levels
+			for (k = 0; k < EYE_STAGES; ++k)
+				eye[i][n][k] = 1 - (double)req[n] / max[n];
+	}
+	for (g = 0; g < N_GROUP; ++g) {
+		to_xyz(full, g, white[g]);
+		c = (unsigned long)groups[g].phases * fwSteps[groups[g].first] <<
+				fwLoopSpeed;
+		if (c > cycle)
+			cycle = c;
+	}
+	start = 1;
+	simHook = tick;
+	sim_run(cycle + 1);
+	ticks = cycle + 1;
+
+	printf("%lu ticks (%.1f s, one envelope cycle), eye %.0f Hz, "
+			"Delta E*ab: mean / max / %% of ticks over %.1f\n",
+			cycle + 1, (cycle + 1) / tickHz, eyeHz, JND);
+	printf("%-10s", "group");
+	for (i = 0; i < N_DE; ++i)
+		printf(" %22s", deName[i]);
+	printf("\n");
+	for (g = 0; g < N_GROUP; ++g) {
+		printf("%-10s", groups[g].name);
+		for (i = 0; i < N_DE; ++i)
+			printf("    %5.2f / %5.2f / %4.1f", de[g][i].sum / ticks,
+					de[g][i].max, 100 * de[g][i].over / ticks);
+		printf("\n");
+	}
+	for (g = 0; g < N_GROUP; ++g)
+		for (i = 0; i < N_DE; i += 2)	// Worst of quantization and total
+			if (de[g][i].max > JND)
+				printf("%s %s worst at tick %lu (%.0f %% of the cycle): "
+						"xyY %.3f %.3f %.1f shown as %.3f %.3f %.1f\n",
+						groups[g].name, deName[i], de[g][i].at,
+						100.0 * de[g][i].at / cycle, de[g][i].want[0],
+						de[g][i].want[1], de[g][i].want[2], de[g][i].got[0],
+						de[g][i].got[1], de[g][i].got[2]);
+	if (trace)
+		fclose(trace);
+	return 0;
+}
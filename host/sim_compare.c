@@ -0,0 +1,168 @@
+//******************************************************************************
+//	Compare point - per channel figures of one build, for host/compare.c
+//
+//	Description:
+//		Built with the MOD_CH_* policies to compare and run once. A host
+//		holds every channel at LEVELS - 1 fractions of max in turn (not 0
+//		and max, where neither modulation switches) and for each level and
+//		channel takes, over MEASURE ticks:
+//			edges		pin edges per second
+//			centroid	power weighted mean frequency of the output, the
+//						DC removed (Hann window, one bin per tick)
+//			spread		power weighted standard deviation of the frequency
+//						around the centroid; PWM keeps its power on the
+//						period and its first harmonics, delta-sigma spreads
+//						it up to half the tick rate
+//			flicker		RMS ripple through the eye model, sim_flicker()
+//		and averages them over the levels. The switching power is for
+//		SW_CAP per pin at VCC as in sim_sweep.c, and the cycles are the
+//		estimated share of calc_output_bits() for one channel, the first
+//		order loop plus what its policy adds (simModCycles in sim.c).
+//
+//		Prints the busiest tick (% of its period) and missed ticks, then
+//		one line per channel: channel, max, policy (DS1, PWM ...), edges/s,
+//		centroid Hz, spread Hz, flicker %, cycles per tick, uW.
+//
+//	Build:
+//		gcc -O2 -Ihost -DMOD_CH_8_9=MOD_PWM -o sim_compare
+//			host/fw.c host/sim.c host/sim_compare.c -lm
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define LEVELS			16		// Held fractions of max[], 1 ... LEVELS - 1
+#define SETTLE			256		// Ticks after a level change
+#define LOG_N			12
+#define MEASURE			(1 << LOG_N)	// Ticks per level, ~2 s
+#define SW_CAP			50e-12	// Pin, trace and LED capacitance, F
+#define VCC				3.6
+#define CYC_DS_CH		14		// calc_output_bits() per channel: add, compare,
+								//   set the bit or subtract
+
+static unsigned char bits[16][MEASURE];	// Output of each channel per tick
+static unsigned long edges[16], lastTicks, t;
+static unsigned int lastFrame;
+static int measuring;
+static double re[MEASURE], im[MEASURE];
+
+static void watch(void) {
+//	simHook - edges and the output bits of this tick
+	unsigned int d = simFrame ^ lastFrame;
+	int n;
+
+	lastFrame = simFrame;
+	if (!measuring || simTicks == lastTicks || t >= MEASURE)
+		return;
+	lastTicks = simTicks;
+	for (n = 0; n < fwChannels; ++n) {
+		bits[n][t] = simFrame >> n & 1;
+		edges[n] += d >> n & 1;
+	}
+	++t;
+}
+
+static void fft(void) {
+//	In place, radix 2, decimation in time
+	unsigned long i, j, k, m, half;
+	double wr, wi, ur, ui, tr, ti, a;
+
+	for (i = 1, j = 0; i < MEASURE; ++i) {
+		for (k = MEASURE >> 1; j & k; k >>= 1)
+			j ^= k;
+		j |= k;
+		if (i < j) {
+			tr = re[i]; re[i] = re[j]; re[j] = tr;
+			ti = im[i]; im[i] = im[j]; im[j] = ti;
+		}
+	}
+	for (m = 2; m <= MEASURE; m <<= 1) {
+		half = m >> 1;
+		a = -2 * M_PI / m;
+		for (k = 0; k < half; ++k) {
+			wr = cos(a * k);
+			wi = sin(a * k);
+			for (i = k; i < MEASURE; i += m) {
+				j = i + half;
+				ur = re[j] * wr - im[j] * wi;
+				ui = re[j] * wi + im[j] * wr;
+				re[j] = re[i] - ur;
+				im[j] = im[i] - ui;
+				re[i] += ur;
+				im[i] += ui;
+			}
+		}
+	}
+}
+
+static void spectrum(int n, double *centroid, double *spread) {
+//	Centroid and spread (bins) of the AC power of channel n
+	double mean = 0, p[MEASURE / 2], total = 0, moment = 0, var = 0;
+	int i;
+
+	for (i = 0; i < MEASURE; ++i)
+		mean += bits[n][i];
+	mean /= MEASURE;
+	for (i = 0; i < MEASURE; ++i) {
+		re[i] = (bits[n][i] - mean) *	// Hann window
+				(0.5 - 0.5 * cos(2 * M_PI * i / MEASURE));
+		im[i] = 0;
+	}
+	fft();
+	for (i = 1; i < MEASURE / 2; ++i) {
+		p[i] = re[i] * re[i] + im[i] * im[i];
+		total += p[i];
+		moment += i * p[i];
+	}
+	*centroid = *spread = 0;
+	if (total <= 0)
+		return;
+	*centroid = moment / total;
+	for (i = 1; i < MEASURE / 2; ++i)
+		var += (i - *centroid) * (i - *centroid) * p[i];
+	*spread = sqrt(var / total);
+}
+
+int main(void) {
+	double tickHz = (double)SIM_SMCLK / SIM_TICK, secs = MEASURE / tickHz;
+	double flicker[16] = { 0 }, centroid[16] = { 0 }, spread[16] = { 0 };
+	double c, w, hz;
+	int k, n;
+
+	sim_reset();
+	lastFrame = simFrame;
+	simHook = watch;
+	hostCtl = 1;
+	for (k = 1; k < LEVELS; ++k) {
+		for (n = 0; n < fwChannels; ++n)
+			req[n] = max[n] * k / LEVELS;
+		measuring = 0;
+		sim_run(SETTLE);
+		sim_flicker_clear();
+		t = 0;
+		measuring = 1;
+		sim_run(MEASURE);
+		for (n = 0; n < fwChannels; ++n) {
+			flicker[n] += sim_flicker(n);
+			spectrum(n, &c, &w);
+			centroid[n] += c;
+			spread[n] += w;
+		}
+	}
+
+	printf("%.1f\t%lu\n", 100.0 * simBusiest / SIM_TICK, simMissed);
+	for (n = 0; n < fwChannels; ++n) {
+		hz = edges[n] / (secs * (LEVELS - 1));
+		printf("%d\t%u\t%s\t%.1f\t%.1f\t%.1f\t%.3f\t%u\t%.3f\n", n, max[n],
+				simModName[fwMod[n]], hz,
+				centroid[n] / (LEVELS - 1) * tickHz / MEASURE,
+				spread[n] / (LEVELS - 1) * tickHz / MEASURE,
+				100 * flicker[n] / (LEVELS - 1),
+				CYC_DS_CH + simModCycles[fwMod[n]],
+				hz * SW_CAP * VCC * VCC / 2 * 1e6);
+	}
+	return 0;
+}
@@ -0,0 +1,116 @@
+//******************************************************************************
+//	Ambient dimming check - LED brightness against a stepped light sensor
+//
+//	Description:
+//		All requests are held by the host at a quarter of max[], so each LED
+//		would be lit 3/4 of the time at full brightness. The analog input
+//		then steps through bright, dim and dark rooms. After each step the
+//		time for dimLvl to settle is reported, then the lit fraction of
+//		every LED is measured and must equal 3/4 * dimLvl/256.
+//
+//		The fades are watched for glitches: the largest dimLvl change in
+//		one conversion and the longest run of ticks with all LED's dark
+//		(the lowest flicker frequency). Undimmed, an LED lit 3/4 of the
+//		time is never dark for two ticks in a row, so the run must stay
+//		within two blanking periods at DIM_MIN.
+//
+//	Build:
+//		gcc -O2 -Ihost -DSD_ADC=1 -DAMBIENT_DIM=1 -o sim_dim
+//			host/fw.c host/sim.c host/sim_dim.c -lm
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define SETTLE			12000	// Ticks after a light step, ~6 filter constants
+#define MEASURE			8192	// Ticks the lit fraction is averaged over
+#define ADC_PINS		0x30	// Channels 4, 5 are the ADC, not LED's
+#define DIM_MIN			16		// DIM_MIN in main.c
+#define MAX_STEP		20		// Largest dimLvl change allowed per conversion
+#define MAX_DEV			0.01	// Lit fraction error allowed
+
+extern unsigned int dimLvl;
+
+static unsigned long lit[16], ticks, lastTicks;
+static unsigned int lastLvl, maxStep, dark, maxDark;
+
+static void watch(void) {
+//------------------------------------------------------------------------------
+// simHook - count lit ticks per LED, dark runs and dimLvl steps
+//------------------------------------------------------------------------------
+	unsigned int step = dimLvl > lastLvl ? dimLvl - lastLvl : lastLvl - dimLvl;
+	int n;
+
+	if (step > maxStep)
+		maxStep = step;
+	lastLvl = dimLvl;
+	if (simTicks == lastTicks)
+		return;
+	lastTicks = simTicks;
+
+	++ticks;
+	for (n = 0; n < fwChannels; ++n)
+		if (simFrame & (1 << n))
+			++lit[n];
+	if (simFrame & ~ADC_PINS & ((1 << fwChannels) - 1))
+		dark = 0;
+	else if (++dark > maxDark)
+		maxDark = dark;
+}
+
+int main(void) {
+	static const double light[] = { 1.0, 0.3, 0.05, 0.0, 0.6 };
+	double want, frac, dev, worst = 0;
+	unsigned long t0;
+	int i, n, fail = 0;
+
+	sim_reset();
+	hostCtl = 1;					// Fixed requests, envelopes off
+	for (n = 0; n < fwChannels; ++n)
+		req[n] = max[n] / 4;
+	lastLvl = dimLvl;
+	simHook = watch;
+
+	for (i = 0; i < 5; ++i) {
+		simAnalogIn = light[i];
+		want = light[i] * 256 + 1;
+		if (want < DIM_MIN)
+			want = DIM_MIN;
+		if (want > 256)
+			want = 256;
+
+		t0 = simTicks;				// Settled = within 3% of full scale
+		while (abs((int)dimLvl - (int)want) > 8 && simTicks - t0 < SETTLE)
+			sim_run(64);
+		printf("light %4.2f: settled in %5.2f s, ", light[i],
+				(double)(simTicks - t0) * SIM_TICK / SIM_SMCLK);
+		sim_run(SETTLE - (simTicks - t0));
+
+		ticks = 0;
+		for (n = 0; n < fwChannels; ++n)
+			lit[n] = 0;
+		sim_run(MEASURE);
+		dev = 0;
+		for (n = 0; n < fwChannels; ++n) {
+			if (ADC_PINS & (1 << n))
+				continue;
+			frac = (double)lit[n] / ticks;
+			want = (1.0 - (double)req[n] / max[n]) * dimLvl / 256;
+			if (frac - want > dev || want - frac > dev)
+				dev = frac > want ? frac - want : want - frac;
+		}
+		printf("dimLvl %3u, lit fraction error %.4f\n", dimLvl, dev);
+		if (dev > worst)
+			worst = dev;
+	}
+
+	fail = simMissed || lateCnt || worst > MAX_DEV || maxStep > MAX_STEP ||
+			maxDark > 2 * 256 / DIM_MIN;
+	printf("%lu ticks, %lu missed, largest dimLvl step %u, "
+			"longest dark %u ticks (%.0f Hz)\n", simTicks, simMissed, maxStep,
+			maxDark, (double)SIM_SMCLK / SIM_TICK / (maxDark + 1));
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
@@ -0,0 +1,156 @@
+//******************************************************************************
+//	Emission spectrum - where the energy of the pin edges goes
+//
+//	Description:
+//		Every output pin that changes draws a current pulse, so the pin
+//		edges are the source of the conducted and radiated emissions.
+//		With the envelopes running, the number of pins that switch at each
+//		instant is sampled every 2 us for 2**19 samples (~1 s), windowed
+//		(Hann) and transformed. Levels are in dB relative to the mean
+//		switching rate (the DC line).
+//
+//		Reported are the strongest line above half the tick rate (1 Hz
+//		resolution; below it the envelopes change how many pins switch),
+//		the strongest line near each of the first tick harmonics, and, as
+//		a measuring receiver in CISPR band A would see it, the largest
+//		power in a 200 Hz bandwidth between 9 and 150 kHz. On the WDT
+//		tick grid all edges repeat with the tick and the energy piles up
+//		on its harmonics; SPREAD_TICK spreads each harmonic over +-1/8 of
+//		its frequency.
+//
+//	Build: (compare the two)
+//		gcc -O2 -Ihost -o sim_emi host/fw.c host/sim.c host/sim_emi.c -lm
+//		gcc -O2 -Ihost -DSPREAD_TICK=1 -o sim_emi
+//			host/fw.c host/sim.c host/sim_emi.c -lm
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#ifndef SPREAD_TICK
+#define SPREAD_TICK		0		// Same -D as the firmware
+#endif
+
+#define LOG_N			19		// 2**19 samples
+#define N				(1UL << LOG_N)
+#define SAMPLE			32		// SMCLK cycles per sample, 500 kHz
+#define SETTLE			1000	// Ticks before sampling starts
+#define HARMONICS		5
+#define RBW				200.0	// Receiver bandwidth, Hz
+#define BAND_LO			9e3		// CISPR band A
+#define BAND_HI			150e3
+
+static double *re, *im;
+static sim_time t0;
+static unsigned int lastFrame;
+
+static void watch(void) {
+//	simHook - pins switched by this ISR into their sample
+	unsigned int d = simFrame ^ lastFrame;
+	unsigned long i;
+
+	lastFrame = simFrame;
+	if (!d || simNow < t0 || (i = (simNow - t0) / SAMPLE) >= N)
+		return;
+	for (; d; d &= d - 1)
+		re[i] += 1;
+}
+
+static void fft(void) {
+//	In place, radix 2, decimation in time
+	unsigned long i, j, k, m, half;
+	double wr, wi, ur, ui, tr, ti, a;
+
+	for (i = 1, j = 0; i < N; ++i) {
+		for (k = N >> 1; j & k; k >>= 1)
+			j ^= k;
+		j |= k;
+		if (i < j) {
+			tr = re[i]; re[i] = re[j]; re[j] = tr;
+			ti = im[i]; im[i] = im[j]; im[j] = ti;
+		}
+	}
+	for (m = 2; m <= N; m <<= 1) {
+		half = m >> 1;
+		a = -2 * M_PI / m;
+		for (k = 0; k < half; ++k) {
+			wr = cos(a * k);
+			wi = sin(a * k);
+			for (i = k; i < N; i += m) {
+				j = i + half;
+				ur = re[j] * wr - im[j] * wi;
+				ui = re[j] * wi + im[j] * wr;
+				re[j] = re[i] - ur;
+				im[j] = im[i] - ui;
+				re[i] += ur;
+				im[i] += ui;
+			}
+		}
+	}
+}
+
+int main(void) {
+	double hz = (double)SIM_SMCLK / SAMPLE / N;	// Bin width
+	double tick = (double)SIM_SMCLK / SIM_TICK, dc, p, peak = 0, rbw = 0, sum;
+	unsigned long i, k, peakK = 0, rbwK = 0, w = (unsigned long)(RBW / hz);
+	unsigned long lo = (unsigned long)(BAND_LO / hz);
+	unsigned long hi = (unsigned long)(BAND_HI / hz);
+	double *pw;
+	int h;
+
+	re = calloc(N, sizeof(double));
+	im = calloc(N, sizeof(double));
+	pw = calloc(N / 2, sizeof(double));
+	sim_reset();
+	sim_run(SETTLE);
+	lastFrame = simFrame;
+	t0 = simNow;
+	simHook = watch;
+	sim_run((unsigned long)(N * SAMPLE / SIM_TICK) + 2);
+
+	for (i = 0; i < N; ++i)			// Hann window
+		re[i] *= 0.5 - 0.5 * cos(2 * M_PI * i / N);
+	fft();
+	dc = re[0] * re[0];
+	for (k = 1; k < N / 2; ++k) {
+		pw[k] = (re[k] * re[k] + im[k] * im[k]) / dc;
+		if (k * hz > tick / 2 && pw[k] > peak) {	// Not the envelopes
+			peak = pw[k];
+			peakK = k;
+		}
+	}
+	for (k = lo, sum = 0; k < hi; ++k) {	// Sliding RBW window
+		sum += pw[k];
+		if (k >= lo + w)
+			sum -= pw[k - w];
+		if (sum > rbw) {
+			rbw = sum;
+			rbwK = k - w / 2;
+		}
+	}
+
+	printf("%s: %lu ticks, strongest line %.1f dB at %.1f Hz\n",
+			SPREAD_TICK ? "spread tick" : "WDT tick", simTicks,
+			10 * log10(peak), peakK * hz);
+	printf("tick harmonics (strongest line within +-1/8):");
+	for (h = 1; h <= HARMONICS; ++h) {
+		p = 0;
+		for (k = (unsigned long)(h * tick * 7 / 8 / hz);
+				k <= (unsigned long)(h * tick * 9 / 8 / hz); ++k)
+			if (pw[k] > p)
+				p = pw[k];
+		printf(" %.1f", 10 * log10(p));
+	}
+	printf(" dB\n%.0f Hz RBW, %.0f - %.0f kHz: peak %.1f dB at %.1f kHz\n",
+			RBW, BAND_LO / 1e3, BAND_HI / 1e3, 10 * log10(rbw),
+			rbwK * hz / 1e3);
+	printf("%lu missed, %u late\n", simMissed, lateCnt);
+	sim_profile();
+	free(re);
+	free(im);
+	free(pw);
+	return simMissed != 0 || lateCnt != 0;
+}
@@ -0,0 +1,127 @@
+//******************************************************************************
+//	Flicker check - visible ripple of steady levels, plain, DITHER, NTF_SHAPED
+//
+//	Description:
+//		A host holds every channel at the same fraction of its max[], from
+//		0 to 1 in LEVELS steps. For each level, after the modulators have
+//		settled, the flicker metric of the simulator (sim_flicker(), the
+//		light through a model of the eye) is taken over MEASURE ticks, and
+//		the lit fraction is compared with 1 - req/max.
+//
+//		Undithered, levels near 1/2, 1/3 ... of max repeat after up to
+//		max ticks and show tones of a few Hz to 100 Hz (see tones.c).
+//		DITHER turns these into noise, which lowers the worst flicker of
+//		the levels from EDGE to 1 - EDGE of max but adds a noise floor to
+//		the levels that had short patterns, so the mean goes up. Nearer to
+//		0 and 1 the few dark or lit ticks are a visible pulse train for any
+//		one bit output at this tick rate, dithered or not.
+//
+//		NTF_SHAPED moves the noise of the levels between the edges of
+//		ntf.h above what the eye sees, mean and worst flicker both go down.
+//
+//		The flicker is reported; the check is that the average stays exact:
+//		the lit time of each level may differ from the ideal by the
+//		integrator (or error history) range only, and no tick may be missed
+//		with the dither or noise shaping cost added. The channels of the
+//		other MOD_CH_* policies are exact over whole periods of max ticks,
+//		which MEASURE cuts, and may differ by up to max.
+//
+//	Build: (compare the two)
+//		gcc -O2 -Ihost -o sim_flicker host/fw.c host/sim.c host/sim_flicker.c -lm
+//		gcc -O2 -Ihost -DDITHER=1 -o sim_flicker
+//			host/fw.c host/sim.c host/sim_flicker.c -lm
+//		gcc -O2 -Ihost -DNTF_SHAPED=1 -o sim_flicker
+//			host/fw.c host/sim.c host/sim_flicker.c -lm
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#ifndef DITHER
+#define DITHER			0		// Same -D as the firmware
+#endif
+#ifndef NTF_SHAPED
+#define NTF_SHAPED		0
+#endif
+#include "../ntf.h"
+#ifndef SWITCH_LIMIT
+#define SWITCH_LIMIT	0
+#endif
+#define LEVELS			200		// Fractions of max[] swept
+#define SETTLE			256		// Ticks after a level change
+#define MEASURE			4096	// Ticks per level, ~2 s
+#define EDGE			(LEVELS / 20)	// Levels kept out of the worst, 5 %
+#define DITHER_MASK		0x3F	// DITHER_MASK in main.c
+
+static unsigned long lit[16], lastTicks;
+
+static void watch(void) {
+//	simHook - lit ticks per channel
+	int n;
+
+	if (simTicks == lastTicks)
+		return;
+	lastTicks = simTicks;
+	for (n = 0; n < fwChannels; ++n)
+		if (simFrame & (1 << n))
+			++lit[n];
+}
+
+int main(void) {
+	double f, worst = 0, edge = 0, total = 0, err, worstErr = 0, bound;
+	int k, n, worstK = 0, worstN = 0, fail = 0;
+
+	sim_reset();
+	hostCtl = 1;
+	simHook = watch;
+	for (k = 0; k <= LEVELS; ++k) {
+		for (n = 0; n < fwChannels; ++n)
+			req[n] = max[n] * k / LEVELS;
+		sim_run(SETTLE);
+		sim_flicker_clear();
+		for (n = 0; n < fwChannels; ++n)
+			lit[n] = 0;
+		sim_run(MEASURE);
+		for (n = 0; n < fwChannels; ++n) {
+			f = sim_flicker(n);
+			total += f;
+			if (k < EDGE || k > LEVELS - EDGE) {
+				if (f > edge)
+					edge = f;
+			}
+			else if (f > worst) {
+				worst = f;
+				worstK = k;
+				worstN = n;
+			}
+			err = fabs(lit[n] - MEASURE * (1.0 - (double)req[n] / max[n]));
+			bound = DITHER ? 2.0 + (double)DITHER_MASK / max[n] : 1.0;
+			if (!strcmp(simModName[fwMod[n]], "DS2"))
+				bound = 2.0 * NTF_ERR_MAX;	// Change of the last error
+			else if (strcmp(simModName[fwMod[n]], "DS1"))
+				bound = max[n];		// Part of a period
+			bound += SWITCH_LIMIT ? 2.0 : 0.0;	// Debt, -1 to +1 tick
+			if (err > worstErr)
+				worstErr = err;
+			fail |= err > bound + 1e-9;
+		}
+	}
+
+	printf("%s: %d levels x %d channels, flicker mean %.3f %%, worst %.3f %% "
+			"(channel %d at req %u/%u), %.3f %% below %d %% or above %d %%\n",
+			DITHER ? "dithered" : NTF_SHAPED ? "shaped" : "plain", LEVELS + 1,
+			fwChannels,
+			100 * total / ((LEVELS + 1) * fwChannels), 100 * worst, worstN,
+			max[worstN] * worstK / LEVELS, max[worstN], 100 * edge,
+			100 * EDGE / LEVELS, 100 - 100 * EDGE / LEVELS);
+	printf("lit time error <= %.2f ticks in %d, %lu missed\n", worstErr,
+			MEASURE, simMissed);
+	sim_profile();
+	fail |= simMissed != 0 || lateCnt != 0;
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
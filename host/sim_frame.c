@@ -0,0 +1,190 @@
+//******************************************************************************
+//	Frame protocol check and throughput benchmark
+//
+//	Description:
+//		First the host library (frame.c) is timed on the PC: encode and
+//		decode of random frames, checked for round trip and against the
+//		standard CRC-8 check value.
+//
+//		Then all 10 channels are updated over the software UART at
+//		115200 baud, back to back, in three ways: one two byte command per
+//		channel, one frame per update, and frames with one bit flipped in
+//		every 8th frame. At every WDT tick req[] must hold a complete
+//		update; a tick that sees a mix of two updates is torn. Commands
+//		tear by design, frames must not, and every corrupted frame must be
+//		rejected (counted in errCnt) without losing more than the frame
+//		that follows it.
+//
+//		Only value and CRC bits are flipped: a CRC-8 catches every single
+//		bit error there. A flipped map bit changes the frame length, so the
+//		receiver compares the CRC with another byte, which passes once in
+//		256 like any random data.
+//
+//	Build:
+//		gcc -O2 -Ihost -DSOFT_UART=1 -o sim_frame
+//			host/fw.c host/sim.c host/frame.c host/sim_frame.c -lm
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "msp430g2211.h"
+#include "sim.h"
+#include "frame.h"
+
+#define BAUD			115200
+#define RXD				BIT2
+#define UPDATES			2000	// Updates sent per mode
+#define BENCH			1000000	// Frames encoded and decoded on the PC
+#define BAD_EVERY		8		// Corrupted frame interval, noisy mode
+#define LOOKAHEAD		3		// Updates a tick may skip (lost frames)
+
+enum { MODE_CMD, MODE_FRAME, MODE_NOISY };
+static const char *const modeName[] = { "commands", "frames", "noisy frames" };
+
+static unsigned char upd[UPDATES][16];	// Complete updates, in order
+static int nUpd, cur = -1;		// Updates expected, last one seen in req[]
+static unsigned long torn, skipped, lastTicks;
+
+static void check_tick(void) {
+//------------------------------------------------------------------------------
+// simHook - at each WDT tick req[] must equal an update at or after cur
+//------------------------------------------------------------------------------
+	int k;
+
+	if (simTicks == lastTicks)
+		return;
+	lastTicks = simTicks;
+	for (k = cur < 0 ? 0 : cur; k < nUpd && k <= cur + LOOKAHEAD; ++k)
+		if (!memcmp(req, upd[k], fwChannels)) {
+			if (cur >= 0 && k > cur + 1)
+				skipped += k - cur - 1;	// Never in req[] at a tick
+			cur = k;
+			return;
+		}
+	if (cur >= 0)
+		++torn;
+}
+
+static void bench(void) {
+//------------------------------------------------------------------------------
+// Host library speed and correctness
+//------------------------------------------------------------------------------
+	static const unsigned char check[] = "123456789";
+	unsigned char buf[FRAME_MAX], val[16], out[16];
+	unsigned int map, got;
+	unsigned long bytes = 0, bad = 0;
+	clock_t t0;
+	int i, n, len;
+
+	t0 = clock();
+	for (i = 0; i < BENCH; ++i) {
+		map = rand() & 0xFFFF;
+		for (n = 0; n < 16; ++n)
+			val[n] = rand();
+		len = frame_encode(buf, map, val);
+		bytes += len;
+		if (frame_decode(buf, len, &got, out) != len || got != map)
+			++bad;
+		for (n = 0; n < 16; ++n)
+			if ((map & (1U << n)) && out[n] != val[n])
+				++bad;
+		buf[1 + rand() % (len - 1)] ^= 1 << (rand() % 8);
+		if (frame_decode(buf, len, &got, out) == len)
+			++bad;					// Single bit errors must not pass
+	}
+	printf("library: %.1f M frames/s, %.0f MB/s encode + decode "
+			"(with rand()), CRC check value 0x%02X, %lu errors\n",
+			BENCH / ((double)(clock() - t0) / CLOCKS_PER_SEC) / 1e6,
+			bytes / ((double)(clock() - t0) / CLOCKS_PER_SEC) / 1e6,
+			frame_crc8(0, check, 9), bad);
+	exit(bad || frame_crc8(0, check, 9) != 0xF4);
+}
+
+static void run(int mode) {
+//------------------------------------------------------------------------------
+// One way of sending the updates, in its own process (firmware boots once)
+//------------------------------------------------------------------------------
+	double bit = (double)SIM_SMCLK / BAUD;
+	unsigned char buf[FRAME_MAX], val[16];
+	unsigned long bytes = 0, corrupted = 0;
+	char lost[16] = "-";			// Commands show no complete update
+	sim_time t, t0;
+	int i, n, len, fail;		// n: channel, or byte in the frame
+
+	sim_edge(0, RXD, 1);
+	sim_reset();
+	sim_run(1);
+	hostCtl = 1;
+	simHook = check_tick;
+	srand(mode + 1);
+
+	t = t0 = sim_uart_tx(SIM_TICK + SIM_TICK / 3, 0x55, bit, RXD);
+	for (i = 0; i < UPDATES; ++i) {
+		for (n = 0; n < fwChannels; ++n)
+			val[n] = rand() % (max[n] + 1);
+		if (mode == MODE_CMD) {
+			for (n = 0; n < fwChannels; ++n) {
+				t = sim_uart_tx(t, 0x80 | n, bit, RXD);
+				t = sim_uart_tx(t, val[n], bit, RXD);
+				bytes += 2;
+			}
+		}
+		else {
+			len = frame_encode(buf, (1U << fwChannels) - 1, val);
+			if (mode == MODE_NOISY && i % BAD_EVERY == BAD_EVERY - 1) {
+				n = 3 + rand() % (len - 3);
+				buf[n] ^= 1 << (rand() % 8);
+				++corrupted;
+			}
+			else
+				memcpy(upd[nUpd], val, fwChannels), ++nUpd;
+			for (n = 0; n < len; ++n)
+				t = sim_uart_tx(t, buf[n], bit, RXD);
+			bytes += len;
+		}
+		if (mode == MODE_CMD)
+			memcpy(upd[nUpd++], val, fwChannels);
+		while (simNow + 64 * SIM_TICK < t)	// Keep the edge queue short
+			sim_run(16);
+	}
+	sim_run((unsigned long)((t - simNow) / SIM_TICK) + 4);
+
+	skipped += nUpd - 1 - cur;		// Never arrived
+	if (mode != MODE_CMD)
+		sprintf(lost, "%lu", skipped);
+	printf("%-12s %5.1f bytes/update, %4.0f updates/s, %5.0f channels/s, "
+			"%4lu torn ticks, %lu/%lu rejected, %s lost, %lu missed\n",
+			modeName[mode], (double)bytes / UPDATES,
+			UPDATES / ((double)(t - t0) / SIM_SMCLK),
+			UPDATES * fwChannels / ((double)(t - t0) / SIM_SMCLK), torn,
+			(unsigned long)errCnt, corrupted, lost, simMissed);
+	fail = simMissed || lateCnt;
+	if (mode != MODE_CMD)
+		fail |= torn || errCnt != corrupted || skipped > corrupted;
+	exit(fail);
+}
+
+int main(void) {
+	int mode, status, fail = 0;
+
+	fflush(stdout);
+	if (!fork())
+		bench();
+	wait(&status);
+	fail |= !WIFEXITED(status) || WEXITSTATUS(status);
+
+	for (mode = MODE_CMD; mode <= MODE_NOISY; ++mode) {
+		fflush(stdout);
+		if (!fork())
+			run(mode);
+		wait(&status);
+		fail |= !WIFEXITED(status) || WEXITSTATUS(status);
+	}
+
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
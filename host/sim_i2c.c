@@ -0,0 +1,231 @@
+//******************************************************************************
+//	I2C slave check - a simulated bus master against the bit-banged slave
+//
+//	Description:
+//		The master writes all req[] registers in one transaction and reads
+//		them back, then reads hostCtl (0x10, has to be 1 after the write)
+//		and the stats registers (0x20-0x23). Each stats byte has to match
+//		tickCnt, lateCnt or errCnt at some point during its read. It
+//		honours clock stretching: after releasing SCL it waits until the
+//		line is really high. A slave that reacts after the master already
+//		released SCL shows up as a bad pair.
+//
+//		For each SCL frequency the good payload throughput, the time the
+//		slave stretched the clock, the worst WDT latency and the missed
+//		ticks are reported. The slave can only stretch once its ISR runs, so
+//		a master whose SCL low time is shorter than the worst interrupt
+//		latency overruns it. Above MAX_HZ pairs may be dropped, but every
+//		bad pair has to be one the slave reported: a NACK or errCnt up
+//		(register 0x23 for a real master). A bad pair without either is
+//		silent corruption and fails at any speed.
+//
+//	Build:
+//		gcc -O2 -Ihost -DI2C_SLAVE=1 -o sim_i2c
+//			host/fw.c host/sim.c host/sim_i2c.c -lm
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/wait.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define SCL				BIT6
+#define SDA				BIT7
+#define ADDR			0x48	// I2C_ADDR in main.c
+#define REG_HOST		0x10
+#define REG_STATS		0x20
+#define TICKS			20000	// Simulated time per bus speed
+#define POLL			4		// Cycles between SCL checks while stretched
+#define MAX_HZ			50000	// Fastest SCL the slave is meant to keep up with
+
+static ucontext_t simSide, masterSide;
+static sim_time wakeAt;			// Next time the master wants to run
+static unsigned int tLow, tHigh;	// SCL timing in SMCLK cycles
+static sim_time stretched;		// Cycles spent waiting for a stretched SCL
+static unsigned long bytes, txns, bad, silent;
+
+//------------------------------------------------------------------------------
+// Master coroutine, blocking calls yield back to the simulator
+//------------------------------------------------------------------------------
+static void bus_wait(unsigned int cycles) {
+	wakeAt = simNow + cycles;
+	swapcontext(&masterSide, &simSide);
+}
+
+static void scl_release(void) {
+	sim_time t = simNow;
+
+	sim_drive(SCL, 1);
+	while (!sim_pin(SCL)) {			// Slave is stretching the clock
+		wakeAt = simNow + POLL;
+		swapcontext(&masterSide, &simSide);
+	}
+	stretched += simNow - t;
+}
+
+static int clock_bit(int out) {
+//	SCL low on entry and exit, returns SDA sampled at the end of SCL high
+	int in;
+
+	sim_drive(SDA, out);
+	bus_wait(tLow);
+	scl_release();
+	bus_wait(tHigh);
+	in = sim_pin(SDA);
+	sim_drive(SCL, 0);
+	return in;
+}
+
+static void start(void) {
+	sim_drive(SDA, 1);
+	bus_wait(tLow);
+	scl_release();
+	bus_wait(tHigh);
+	sim_drive(SDA, 0);				// SDA falls with SCL high
+	bus_wait(tHigh);
+	sim_drive(SCL, 0);
+}
+
+static void stop(void) {
+	sim_drive(SDA, 0);
+	bus_wait(tLow);
+	scl_release();
+	bus_wait(tHigh);
+	sim_drive(SDA, 1);				// SDA rises with SCL high
+	bus_wait(tLow);
+}
+
+static int write_byte(unsigned char c) {
+//	Returns 1 if the slave ACKed
+	int i;
+
+	for (i = 7; i >= 0; --i)
+		clock_bit((c >> i) & 1);
+	return !clock_bit(1);
+}
+
+static unsigned char read_byte(int ack) {
+	unsigned char c = 0;
+	int i;
+
+	for (i = 0; i < 8; ++i)
+		c = (c << 1) | clock_bit(1);
+	clock_bit(!ack);
+	return c;
+}
+
+static int read_regs(unsigned char reg, unsigned char *rd, int count) {
+//	Register pointer, repeated start, count bytes, the last one NACKed.
+//	Returns 1 if the slave ACKed
+	int n, ok;
+
+	start();
+	ok = write_byte(ADDR << 1) && write_byte(reg);
+	start();
+	ok = ok && write_byte((ADDR << 1) | 1);
+	for (n = 0; n < count && ok; ++n)
+		rd[n] = read_byte(n < count - 1);
+	stop();
+	return ok;
+}
+
+static int within(unsigned int v, unsigned int from, unsigned int to) {
+//	v was between from and to, counting up with wraparound
+	return ((v - from) & 0xFF) <= ((to - from) & 0xFF);
+}
+
+static void master(void) {
+	unsigned char val[16], rd[16], host, stats[4];
+	unsigned char err, late0, err0;
+	unsigned int tick0;
+	int i, n, acked, same;
+
+	for (;;) {
+		err = errCnt;
+		for (n = 0; n < fwChannels; ++n)
+			val[n] = rand() % (max[n] + 1);
+
+		start();					// Write req[0..N_CH-1]
+		acked = write_byte(ADDR << 1) && write_byte(0);
+		for (n = 0; n < fwChannels && acked; ++n)
+			acked = write_byte(val[n]);
+		stop();
+
+		acked = acked && read_regs(0, rd, fwChannels);	// Read them back
+		acked = acked && read_regs(REG_HOST, &host, 1);
+		tick0 = tickCnt;
+		late0 = lateCnt;
+		err0 = errCnt;
+		acked = acked && read_regs(REG_STATS, stats, 4);
+
+		same = acked && host == 1 && within(stats[0], tick0, tickCnt) &&
+				within(stats[1], tick0 >> 8, tickCnt >> 8) &&
+				within(stats[2], late0, lateCnt) &&
+				within(stats[3], err0, errCnt);
+		for (i = 0; i < fwChannels; ++i)
+			same = same && rd[i] == val[i];
+		if (same)
+			bytes += 2 * fwChannels + 5;
+		else {
+			++bad;
+			silent += acked && errCnt == err;
+		}
+		txns += 4;
+	}
+}
+
+static sim_time device(sim_time t) {
+//------------------------------------------------------------------------------
+// simDevice - resume the master where it blocked
+//------------------------------------------------------------------------------
+	(void)t;						// The master keeps its own time, simNow
+	swapcontext(&simSide, &masterSide);
+	return wakeAt;
+}
+
+static void run(unsigned long hz) {
+//------------------------------------------------------------------------------
+// One bus speed, in its own process since the firmware boots only once
+//------------------------------------------------------------------------------
+	static char stack[64 * 1024];
+	double sec = (double)TICKS * SIM_TICK / SIM_SMCLK;
+
+	tLow = tHigh = SIM_SMCLK / hz / 2;
+	getcontext(&masterSide);
+	masterSide.uc_stack.ss_sp = stack;
+	masterSide.uc_stack.ss_size = sizeof(stack);
+	makecontext(&masterSide, master, 0);
+
+	sim_reset();
+	sim_run(1);
+	simDevice = device;
+	simDeviceAt = simNow + 1;
+	sim_run(TICKS);
+
+	printf("%4lu kHz SCL: %5.0f payload bytes/s, %4lu/%lu pairs bad (%lu "
+			"silent), stretched %4.1f%%, WDT latency <= %u cycles, %lu "
+			"missed%s\n",
+			hz / 1000, bytes / sec, bad, txns / 4, silent,
+			100.0 * stretched / ((double)TICKS * SIM_TICK),
+			simLatency, simMissed, hz > MAX_HZ ? " (too fast)" : "");
+	exit(simMissed || lateCnt || silent || !txns || (hz <= MAX_HZ && bad));
+}
+
+int main(void) {
+	static const unsigned long hz[] = { 10000, 25000, 50000, 100000 };
+	int i, status, fail = 0;
+
+	for (i = 0; i < 4; ++i) {
+		fflush(stdout);
+		if (!fork())
+			run(hz[i]);
+		wait(&status);
+		fail |= !WIFEXITED(status) || WEXITSTATUS(status);
+	}
+
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
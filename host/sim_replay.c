@@ -0,0 +1,151 @@
+//******************************************************************************
+//	Replay of recorded control traffic against the golden bitstream
+//
+//	Description:
+//		Feeds a log written by lightd -w (ctllog.h) into the simulator:
+//		every record goes onto RXD at the tick and cycle it was sent at,
+//		as fast as the PC allows. The run is deterministic, so the output
+//		of every tick (simFrame, one bit per channel) is a bitstream that
+//		only changes when the firmware does.
+//
+//		-g writes that bitstream as the golden file, 2 bytes per tick,
+//		little endian. -c compares a run against a golden file and stops
+//		at the first tick that differs, with the channels and the last
+//		record before it. The exit code is 0 on a match, so a regression
+//		is bisected with
+//			git bisect run sh -c "gcc ... && ./sim_replay -c show.gold show.log"
+//
+//	Build:
+//		gcc -O2 -Ihost -DSOFT_UART=1 -o sim_replay
+//			host/fw.c host/sim.c host/ctllog.c host/sim_replay.c -lm
+//	Run:
+//		./sim_replay [-g|-c golden] [-n ticks after the log] log
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "msp430g2211.h"
+#include "sim.h"
+#include "ctllog.h"
+
+#define RXD				BIT2
+#define TAIL			2000	// Ticks run after the last record, ~1 s
+#define RECENT			256		// Record times kept, > records in 64 ticks
+
+static FILE *gold;
+static int check;				// 1: compare with gold, 0: write it
+static unsigned long lastTicks, diffTick, hash = 2166136261UL;
+static unsigned int diffBits;
+static sim_time recent[RECENT];	// Start of the last records fed in
+
+static void tick(void) {
+//------------------------------------------------------------------------------
+// simHook - hash each tick's output, write it or compare it with the golden
+//------------------------------------------------------------------------------
+	int c, i;
+
+	if (simTicks == lastTicks || diffTick)
+		return;
+	lastTicks = simTicks;
+	for (i = 0; i < 2; ++i)			// FNV-1a
+		hash = ((hash ^ (simFrame >> 8 * i & 0xFF)) * 16777619UL) & 0xFFFFFFFFUL;
+	if (!gold)
+		return;
+	if (!check) {
+		fputc(simFrame & 0xFF, gold);
+		fputc(simFrame >> 8, gold);
+		return;
+	}
+	c = fgetc(gold);
+	c |= fgetc(gold) << 8;
+	if (c < 0 || (unsigned int)c != simFrame) {
+		diffTick = simTicks;
+		diffBits = c < 0 ? 0xFFFF : c ^ simFrame;
+	}
+}
+
+int main(int argc, char **argv) {
+	unsigned char buf[CTLLOG_MAX];
+	unsigned long records = 0, bytes = 0, tail = TAIL;
+	const char *goldPath = NULL;
+	ctllog log;
+	clock_t c0;
+	sim_time t;
+	double secs, bit;
+	int i, len, opt;
+
+	while ((opt = getopt(argc, argv, "g:c:n:")) != -1) {
+		if (opt == 'g' || opt == 'c') {
+			goldPath = optarg;
+			check = opt == 'c';
+		}
+		else if (opt == 'n')
+			tail = atol(optarg);
+		else
+			optind = argc + 1;
+	}
+	if (optind != argc - 1) {
+		fprintf(stderr, "usage: sim_replay [-g|-c golden] [-n ticks] log\n");
+		return 2;
+	}
+	if (!ctllog_open(&log, argv[optind])) {
+		fprintf(stderr, "sim_replay: %s is no control log\n", argv[optind]);
+		return 2;
+	}
+	if (goldPath && !(gold = fopen(goldPath, check ? "rb" : "wb"))) {
+		perror("sim_replay: golden");
+		return 2;
+	}
+	bit = (double)SIM_SMCLK / log.baud;
+
+	c0 = clock();
+	sim_edge(0, RXD, 1);
+	sim_reset();
+	simHook = tick;
+	while (!diffTick && (len = ctllog_read(&log, &t, buf))) {
+		if (t < simNow)
+			t = simNow;				// Cannot happen with lightd's logs
+		recent[records % RECENT] = t;
+		for (i = 0; i < len; ++i)
+			t = sim_uart_tx(t, buf[i], bit, RXD);
+		++records;
+		bytes += len;
+		while (simNow + 64 * SIM_TICK < t)	// Keep the edge queue short
+			sim_run(16);
+	}
+	if (!diffTick)
+		sim_run((unsigned long)((t > simNow ? t - simNow : 0) / SIM_TICK) +
+				tail);
+	while (!diffTick && check && fgetc(gold) != EOF)
+		diffTick = simTicks + 1;	// Golden run was longer
+	secs = (double)(clock() - c0) / CLOCKS_PER_SEC;
+
+	printf("%lu records, %lu bytes at %lu baud, %lu ticks (%.1f s) "
+			"in %.2f s, %.0fx real time\n", records, bytes, log.baud, simTicks,
+			(double)simTicks * SIM_TICK / SIM_SMCLK, secs,
+			(double)simTicks * SIM_TICK / SIM_SMCLK / (secs > 0 ? secs : 1e-6));
+	printf("%u link errors, %u late, %lu missed, bitstream hash %08lX\nreq[]",
+			errCnt, lateCnt, simMissed, hash);
+	for (i = 0; i < fwChannels; ++i)
+		printf(" %u", req[i]);
+	printf("\n");
+	ctllog_close(&log);
+	if (gold)
+		fclose(gold);
+	if (diffTick) {
+		for (i = 1; i < RECENT && i < (int)records &&
+				recent[(records - i) % RECENT] / SIM_TICK >= diffTick; ++i)
+			;						// Queued ahead of the difference
+		printf("differs from %s at tick %lu (%.4f s), channels 0x%03X, "
+				"last record at tick %lu\nFAIL\n", goldPath, diffTick,
+				(double)diffTick * SIM_TICK / SIM_SMCLK, diffBits,
+				records ? (unsigned long)(recent[(records - i) % RECENT] /
+					SIM_TICK) : 0);
+		return 1;
+	}
+	if (check)
+		printf("matches %s\nPASS\n", goldPath);
+	return 0;
+}
@@ -0,0 +1,104 @@
+//******************************************************************************
+//	Sweep point - the figures of one configuration, for host/sweep.c
+//
+//	Description:
+//		Built with the -D of one configuration (MAX_CH_*, STEPS_CH_*,
+//		LOOP_SPEED, TICK_CYCLES and any option) and run once. From reset
+//		the envelopes run for ENV_SECONDS; counted are the pin edges and,
+//		for each envelope step, the largest level change of a channel as a
+//		fraction of its max. Then a host holds every channel at LEVELS + 1
+//		fractions of max in turn and the flicker metric of the simulator
+//		(sim_flicker()) is averaged over them.
+//
+//		Prints one line, the columns of sweep.c:
+//			busiest tick, % of the shortest tick period (SPREAD_MIN with
+//			SPREAD_TICK)
+//			missed ticks
+//			mean flicker of the held levels, % of full brightness
+//			pin edges per second with the envelopes
+//			their switching power, uW, for SW_CAP per pin at VCC
+//			largest level jump of an envelope step, % of full brightness
+//			envelope steps per second
+//			largest LOOP_SPEED the options of this build allow
+//
+//	Build:
+//		gcc -O2 -Ihost -DLOOP_SPEED=5 -o sim_sweep
+//			host/fw.c host/sim.c host/sim_sweep.c -lm
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define ENV_SECONDS		16		// Envelope run, target time
+#define LEVELS			63		// Held fractions of max[], not just 1/2, 1/4 ...
+#define SETTLE			256		// Ticks after a level change
+#define MEASURE			2048	// Ticks per held level
+#define SW_CAP			50e-12	// Pin, trace and LED capacitance, F
+#define VCC				3.6
+
+extern const unsigned char fwLoopMax;
+extern const unsigned int fwTickMin;
+
+static unsigned char lastReq[16];
+static unsigned int lastFrame;
+static unsigned long lastTicks, edges, steps;
+static double jump;
+
+static void watch(void) {
+//	simHook - edges, and level changes of the envelopes, once per tick
+	unsigned int d = simFrame ^ lastFrame;
+	double j;
+	int n, changed = 0;
+
+	lastFrame = simFrame;
+	for (; d; d &= d - 1)
+		++edges;
+	if (simTicks == lastTicks)
+		return;
+	lastTicks = simTicks;
+	for (n = 0; n < fwChannels; ++n) {
+		if (req[n] == lastReq[n])
+			continue;
+		changed = 1;
+		j = (double)abs(req[n] - lastReq[n]) / max[n];
+		if (j > jump)
+			jump = j;
+		lastReq[n] = req[n];
+	}
+	steps += changed;
+}
+
+int main(void) {
+	double tickHz = (double)SIM_SMCLK / SIM_TICK, secs, flicker = 0;
+	unsigned long ticks = (unsigned long)(ENV_SECONDS * tickHz);
+	int k, n;
+
+	sim_reset();
+	for (n = 0; n < fwChannels; ++n)
+		lastReq[n] = req[n];
+	lastFrame = simFrame;
+	simHook = watch;
+	sim_run(ticks);
+	secs = simTicks / tickHz;
+
+	hostCtl = 1;
+	simHook = NULL;
+	for (k = 0; k <= LEVELS; ++k) {
+		for (n = 0; n < fwChannels; ++n)
+			req[n] = max[n] * k / LEVELS;
+		sim_run(SETTLE);
+		sim_flicker_clear();
+		sim_run(MEASURE);
+		for (n = 0; n < fwChannels; ++n)
+			flicker += sim_flicker(n);
+	}
+	flicker /= (LEVELS + 1) * fwChannels;
+
+	printf("%.1f\t%lu\t%.3f\t%.0f\t%.1f\t%.2f\t%.1f\t%u\n",
+			100.0 * simBusiest / fwTickMin, simMissed, 100 * flicker,
+			edges / secs, edges / secs * SW_CAP * VCC * VCC / 2 * 1e6,
+			100 * jump, steps / secs, fwLoopMax);
+	return 0;
+}
@@ -0,0 +1,128 @@
+//******************************************************************************
+//	Simultaneous switching - how many pins change on one tick, SWITCH_LIMIT
+//
+//	Description:
+//		Every pin that changes on a tick adds a step to the supply current,
+//		so the peak number changing together sets the ground bounce. Their
+//		histogram is taken over three runs:
+//			envelopes	from the first tick after reset, ENV_TICKS
+//			half		a host holds every channel at max/2, the worst
+//						case: each modulator flips on every tick
+//			random		a host holds fixed pseudo-random levels
+//		With SWITCH_LIMIT the ticks over it are counted too: only channels
+//		paying back a held change can take the count past the limit.
+//		The held runs also check that the averages stay exact: the lit
+//		time of each channel may differ from 1 - req/max by the first-order
+//		range plus the change of the debt SWITCH_LIMIT carries, -1 to +1.
+//
+//	Build: (compare the two)
+//		gcc -O2 -Ihost -o sim_switch host/fw.c host/sim.c host/sim_switch.c -lm
+//		gcc -O2 -Ihost -DSWITCH_LIMIT=4 -o sim_switch
+//			host/fw.c host/sim.c host/sim_switch.c -lm
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#ifndef SWITCH_LIMIT
+#define SWITCH_LIMIT	0		// Same -D as the firmware
+#endif
+
+#define ENV_TICKS		65536
+#define SETTLE			256		// Ticks after the levels are set
+#define MEASURE			16384	// Ticks per held run
+#define RUNS			3
+
+static const char *const runName[RUNS] = { "envelopes", "half", "random" };
+static unsigned long hist[RUNS][17], lit[16], lastTicks;
+static unsigned int lastFrame;
+static int run, counting;
+
+static void watch(void) {
+//	simHook - pins changed by this tick, lit ticks per channel
+	unsigned int d = simFrame ^ lastFrame;
+	int k = 0, n;
+
+	lastFrame = simFrame;
+	if (simTicks == lastTicks || !counting)
+		return;
+	lastTicks = simTicks;
+	for (; d; d &= d - 1)
+		++k;
+	++hist[run][k];
+	for (n = 0; n < fwChannels; ++n)
+		if (simFrame & (1 << n))
+			++lit[n];
+}
+
+int main(void) {
+	double err, worstErr = 0, bound = SWITCH_LIMIT ? 3.0 : 1.0;
+	unsigned long total, over, rnd = 12345;
+	int n, k, peak[RUNS], fail = 0;
+
+	sim_reset();
+	simHook = watch;
+	sim_run(2);				// Pins leave their reset state together
+	counting = 1;
+	sim_run(ENV_TICKS);
+
+	hostCtl = 1;
+	for (run = 1; run < RUNS; ++run) {
+		for (n = 0; n < fwChannels; ++n) {
+			rnd = rnd * 1103515245 + 12345;
+			req[n] = run == 1 ? max[n] / 2 : (rnd >> 16) % (max[n] + 1);
+		}
+		counting = 0;
+		sim_run(SETTLE);
+		for (n = 0; n < fwChannels; ++n)
+			lit[n] = 0;
+		counting = 1;
+		sim_run(MEASURE);
+		for (n = 0; n < fwChannels; ++n) {
+			err = fabs(lit[n] - MEASURE * (1.0 - (double)req[n] / max[n]));
+			if (err > worstErr)
+				worstErr = err;
+			fail |= err > bound + 1e-9;
+		}
+	}
+
+	printf("SWITCH_LIMIT %d: %% of ticks with k pins changing\n", SWITCH_LIMIT);
+	printf("   k");
+	for (run = 0; run < RUNS; ++run)
+		printf(" %10s", runName[run]);
+	printf("\n");
+	for (run = 0; run < RUNS; ++run)
+		for (peak[run] = 16; peak[run] && !hist[run][peak[run]]; --peak[run])
+			;
+	for (k = 0; k <= fwChannels; ++k) {
+		printf("  %2d", k);
+		for (run = 0; run < RUNS; ++run) {
+			for (n = 0, total = 0; n <= 16; ++n)
+				total += hist[run][n];
+			printf(" %10.2f", 100.0 * hist[run][k] / total);
+		}
+		printf("\n");
+	}
+	printf("peak");
+	for (run = 0; run < RUNS; ++run)
+		printf(" %10d", peak[run]);
+	if (SWITCH_LIMIT) {
+		printf("\nover");
+		for (run = 0; run < RUNS; ++run) {
+			for (n = 0, total = 0, over = 0; n <= 16; ++n) {
+				total += hist[run][n];
+				over += n > SWITCH_LIMIT ? hist[run][n] : 0;
+			}
+			printf(" %9.2f%%", 100.0 * over / total);
+		}
+	}
+	printf("\nlit time error <= %.2f ticks in %d (bound %.0f), %lu missed\n",
+			worstErr, MEASURE, bound, simMissed);
+	sim_profile();
+	fail |= simMissed != 0 || lateCnt != 0;
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
@@ -0,0 +1,203 @@
+//******************************************************************************
+//	LED thermal and current model - junction temperatures from the bitstreams
+//
+//	Description:
+//		Each channel's output bit drives its LED die for the whole tick with
+//		(VCC - Vf) / (R + R_PIN), R the series resistor of the schematic in
+//		main.c (33 ohm for the blue dies) and Vf falling with the junction
+//		temperature. The die dissipates I * Vf and is a thermal RC to its
+//		package (R_JP, TAU_J); the dies of one LED share the package, an RC
+//		to ambient (R_PA, TAU_P). Both are stepped once per tick with the
+//		exact exponential of the tick, so the run is streamed: the state and
+//		the report are a few numbers per channel, however long it runs.
+//
+//		Reported per LED and die: average and peak current, average power,
+//		peak and final junction temperature, and the light output at the
+//		peak against 25 C (typical flux coefficients per colour). Also the
+//		largest current the ports source and sink in one tick: common anode
+//		dies (fwAnode1/2, channels 0-5) are lit by a low pin and sink, the
+//		others source. FAIL if a junction goes over -t (default 85 C), or
+//		the ports source or sink more than -P source,sink (default 48,48
+//		mA, the MSP430G2211 limits for all outputs high and all low).
+//
+//		-s sets the simulated time (default 300 s, ~0.6 M ticks, a few s on
+//		a PC), -a the ambient, -H holds every channel lit for that fraction
+//		of the time instead of the envelopes (e.g. -H 1 for full on), -R the
+//		ten series resistors, e.g. -R 100,100,33,100,100,33,100,100,100,100.
+//		The LED data is typical for 5 mm parts.
+//
+//	Build:
+//		gcc -O2 -Ihost -o sim_thermal host/fw.c host/sim.c host/sim_thermal.c -lm
+//	Run:
+//		./sim_thermal [-s seconds] [-a ambient C] [-H lit] [-R ohms] [-t C]
+//			[-P source mA,sink mA]
+//******************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define VCC				3.6
+#define R_PIN			27.0	// Port driver at ~15 mA, ohm
+#define R_JP			150.0	// Die to package, K/W
+#define TAU_J			0.01	// Die time constant, s
+#define R_PA			200.0	// Package to ambient (5 mm, leads), K/W
+#define TAU_P			30.0	// Package time constant, s
+#define T_REF			25.0	// Vf and flux given at, C
+#define N_LED			4
+
+extern const unsigned char fwAnode1, fwAnode2;
+
+enum { RED, GREEN, BLUE };
+static const char *const colName[3] = { "red", "green", "blue" };
+static const double vf0[3] = { 2.0, 3.0, 3.1 };		// V at T_REF, ~15 mA
+static const double vfTc[3] = { -2.0e-3, -3.0e-3, -3.0e-3 };	// V/K
+static const double fluxTc[3] = { -0.9e-2, -0.4e-2, -0.2e-2 };	// 1/K
+
+static const struct {
+	const char *name;
+	int first, n;				// Channels
+} leds[N_LED] = {
+	{ "RGB_LED_1", 0, 3 }, { "RGB_LED_2", 3, 3 },
+	{ "RG_LED_1", 6, 2 }, { "RG_LED_2", 8, 2 } };
+static const int colour[10] = { RED, GREEN, BLUE, RED, GREEN, BLUE,
+		RED, GREEN, RED, GREEN };
+static double ohms[10] = { 100, 100, 33, 100, 100, 33, 100, 100, 100, 100 };
+
+static double tj[10], tp[N_LED];	// Junction and package temperatures
+static double kj, kp;				// exp(-tick / tau)
+static double ambient = 25;
+static unsigned long lastTicks, ticks;
+static struct {
+	double iSum, iPeak, pSum, tjPeak;
+	unsigned long peakAt;		// Tick of tjPeak
+} ch[10];
+static int sinks[10];			// 1 = common anode, lit by a low pin
+static double srcPeak, sinkPeak;	// Most current in one tick
+
+static void tick(void) {
+//------------------------------------------------------------------------------
+// simHook - one tick of every die and package
+//------------------------------------------------------------------------------
+	double i, p, heat, ss, src = 0, sink = 0;
+	int l, k, n;
+
+	if (simTicks == lastTicks)
+		return;
+	lastTicks = simTicks;
+	for (l = 0; l < N_LED; ++l) {
+		heat = 0;
+		for (k = 0; k < leds[l].n; ++k) {
+			n = leds[l].first + k;
+			i = p = 0;
+			if (simFrame >> n & 1) {
+				p = vf0[colour[n]] + vfTc[colour[n]] * (tj[n] - T_REF);
+				i = (VCC - p) / (ohms[n] + R_PIN);
+				if (i < 0)
+					i = 0;
+				p *= i;
+			}
+			if (sinks[n])
+				sink += i;
+			else
+				src += i;
+			ss = tp[l] + p * R_JP;		// Die settles there over the package
+			tj[n] = ss + (tj[n] - ss) * kj;
+			heat += (tj[n] - tp[l]) / R_JP;
+			ch[n].iSum += i;
+			ch[n].pSum += p;
+			if (i > ch[n].iPeak)
+				ch[n].iPeak = i;
+			if (tj[n] > ch[n].tjPeak) {
+				ch[n].tjPeak = tj[n];
+				ch[n].peakAt = simTicks;
+			}
+		}
+		ss = ambient + heat * R_PA;
+		tp[l] = ss + (tp[l] - ss) * kp;
+	}
+	if (src > srcPeak)
+		srcPeak = src;
+	if (sink > sinkPeak)
+		sinkPeak = sink;
+	++ticks;
+}
+
+int main(int argc, char **argv) {
+	double tickHz = (double)SIM_SMCLK / SIM_TICK, seconds = 300, lit = -1;
+	double limit = 85, hot = 0, srcLimit = 48e-3, sinkLimit = 48e-3;
+	char *s;
+	int opt, l, k, n, fail;
+
+	while ((opt = getopt(argc, argv, "s:a:H:R:t:P:")) != -1) {
+		if (opt == 's')
+			seconds = atof(optarg);
+		else if (opt == 'a')
+			ambient = atof(optarg);
+		else if (opt == 'H')
+			lit = atof(optarg);
+		else if (opt == 't')
+			limit = atof(optarg);
+		else if (opt == 'P') {
+			srcLimit = strtod(optarg, &s) * 1e-3;
+			if (*s == ',')
+				sinkLimit = atof(s + 1) * 1e-3;
+		}
+		else if (opt == 'R')
+			for (s = optarg, n = 0; *s && n < 10; ++n) {
+				ohms[n] = strtod(s, &s);
+				if (*s == ',')
+					++s;
+			}
+		else {
+			fprintf(stderr, "usage: sim_thermal [-s seconds] [-a ambient C] "
+					"[-H lit] [-R ohms] [-t C] [-P source mA,sink mA]\n");
+			return 2;
+		}
+	}
+	kj = exp(-1 / (tickHz * TAU_J));
+	kp = exp(-1 / (tickHz * TAU_P));
+	for (n = 0; n < 10; ++n) {
+		tj[n] = ch[n].tjPeak = ambient;
+		sinks[n] = (n < 8 ? fwAnode1 >> n : fwAnode2 >> (n - 2)) & 1;
+	}
+	for (l = 0; l < N_LED; ++l)
+		tp[l] = ambient;
+
+	sim_reset();
+	if (lit >= 0) {
+		hostCtl = 1;
+		for (n = 0; n < fwChannels; ++n)
+			req[n] = (unsigned char)(max[n] * (1 - lit) + 0.5);
+	}
+	simHook = tick;
+	sim_run((unsigned long)(seconds * tickHz));
+
+	printf("%.0f s at %.0f C ambient, %s\n", ticks / tickHz, ambient,
+			lit >= 0 ? "held levels" : "envelopes");
+	printf("LED        die    ohm  I avg mA  I peak mA  P avg mW  Tj peak C"
+			"  (at s)  Tj end C  light at peak\n");
+	for (l = 0; l < N_LED; ++l)
+		for (k = 0; k < leds[l].n; ++k) {
+			n = leds[l].first + k;
+			printf("%-10s %-5s %5.0f %9.2f %10.2f %9.2f %10.1f %7.1f %9.1f "
+					"%+12.1f %%\n", k ? "" : leds[l].name, colName[colour[n]],
+					ohms[n], 1e3 * ch[n].iSum / ticks, 1e3 * ch[n].iPeak,
+					1e3 * ch[n].pSum / ticks, ch[n].tjPeak,
+					ch[n].peakAt / tickHz, tj[n],
+					100 * fluxTc[colour[n]] * (ch[n].tjPeak - T_REF));
+			if (ch[n].tjPeak > hot)
+				hot = ch[n].tjPeak;
+		}
+	printf("ports source at most %.1f mA in one tick (limit %.0f mA), sink "
+			"%.1f mA (limit %.0f mA), hottest junction %.1f C (limit %.0f C)\n",
+			1e3 * srcPeak, 1e3 * srcLimit, 1e3 * sinkPeak, 1e3 * sinkLimit, hot,
+			limit);
+	fail = hot > limit || srcPeak > srcLimit || sinkPeak > sinkLimit;
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
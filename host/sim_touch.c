@@ -0,0 +1,101 @@
+//******************************************************************************
+//	Capacitive touch check - taps and holds on the P1.1 pad model in sim.c
+//
+//	Description:
+//		Runs a script of finger events against the colour envelopes: taps
+//		that must step the program, a brush too short to count, a finger
+//		hovering near the pad, and a long hold that must step the
+//		brightness without changing the program. After each event the
+//		rate of req[] change shows the program in effect and the lit
+//		fraction of all LED's shows the brightness.
+//
+//		The touch measurement uses no interrupt, so the WDT latency has to
+//		stay 0 and no tick may be missed. The profile at the end lists the
+//		per-tick cost of calc_touch() next to the rest of the firmware.
+//
+//	Build:
+//		gcc -O2 -Ihost -DCAP_TOUCH=1 -o sim_touch
+//			host/fw.c host/sim.c host/sim_touch.c -lm
+//******************************************************************************
+
+#include <stdio.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define TICKS_MS(ms)	((unsigned long)(ms) * SIM_SMCLK / SIM_TICK / 1000)
+#define PAD				BIT1	// Channel 1 is the pad, not an LED
+#define PROG_CYCLE		0		// Programs as in main.c
+#define PROG_FAST		1
+#define PROG_HOLD		2
+
+extern unsigned char touchProg, touchDim;
+extern unsigned int dimLvl;
+
+static unsigned char shadow[16];
+static unsigned long steps, lit, ticks, lastTicks;
+
+static void watch(void) {
+//------------------------------------------------------------------------------
+// simHook - add up req[] changes and count lit LED ticks
+//------------------------------------------------------------------------------
+	int n;
+
+	for (n = 0; n < fwChannels; ++n)
+		if (req[n] != shadow[n]) {
+			steps += req[n] > shadow[n] ? req[n] - shadow[n] :
+					shadow[n] - req[n];
+			shadow[n] = req[n];
+		}
+	if (simTicks == lastTicks)
+		return;
+	lastTicks = simTicks;
+	++ticks;
+	for (n = 0; n < fwChannels; ++n)
+		if (!(PAD & (1 << n)) && (simFrame & (1 << n)))
+			++lit;
+}
+
+static int event(const char *what, double finger, unsigned int ms,
+		int prog, int dim) {
+//------------------------------------------------------------------------------
+// Finger on for ms, then off for 1 s; 1 if program or brightness is wrong
+//------------------------------------------------------------------------------
+	simTouch = finger;
+	sim_run(TICKS_MS(ms));
+	simTouch = 0;
+	sim_run(TICKS_MS(200));
+
+	steps = lit = ticks = 0;
+	sim_run(TICKS_MS(800));
+	printf("%-22s program %u, brightness %u (dimLvl %3u): "
+			"%5.0f req change/s, %4.1f%% lit %s\n", what, touchProg, touchDim,
+			dimLvl, steps / 0.8, 100.0 * lit / ticks / (fwChannels - 1),
+			touchProg == prog && touchDim == dim ? "ok" : "WRONG");
+	return touchProg != prog || touchDim != dim;
+}
+
+int main(void) {
+	int n, fail = 0;
+
+	sim_reset();
+	for (n = 0; n < fwChannels; ++n)
+		shadow[n] = req[n];
+	simHook = watch;
+	sim_run(TICKS_MS(500));			// Baseline settles
+
+	fail |= event("idle", 0, 0, PROG_CYCLE, 0);
+	fail |= event("tap 150 ms", 1, 150, PROG_FAST, 0);
+	fail |= event("brush 10 ms", 1, 10, PROG_FAST, 0);
+	fail |= event("hover (20% coupling)", 0.2, 2000, PROG_FAST, 0);
+	fail |= event("tap 300 ms", 1, 300, PROG_HOLD, 0);
+	fail |= event("tap 100 ms", 0.7, 100, PROG_CYCLE, 0);
+	fail |= event("hold 1.2 s", 1, 1200, PROG_CYCLE, 2);
+	fail |= event("hold 1.2 s", 1, 1200, PROG_CYCLE, 0);
+
+	printf("%lu ticks, %lu missed, WDT latency <= %u cycles\n",
+			simTicks, simMissed, simLatency);
+	sim_profile();
+	fail |= simMissed || lateCnt || simLatency;
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
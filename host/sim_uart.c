@@ -0,0 +1,152 @@
+//******************************************************************************
+//	Software UART check - request updates streamed while the modulators run
+//
+//	Description:
+//		Sends the autobaud char and then back to back request updates with
+//		no idle time between chars, with the DCO off its nominal frequency.
+//		Every update must land in req[] in order, and no WDT tick may be
+//		missed. The worst WDT ISR latency is the jitter the UART adds to the
+//		outputs.
+//
+//		Then the resume case: with the envelopes running, every request is
+//		set to 1 and control handed back with hostCtl = 0. The envelopes
+//		have to go on from their own levels, so req[n] <= max[n] on every
+//		tick of two envelope cycles.
+//
+//	Build:
+//		gcc -O2 -Ihost -DSOFT_UART=1 -o sim_uart
+//			host/fw.c host/sim.c host/sim_uart.c -lm
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define UPDATES			20000	// Request updates sent per baud rate
+#define RXD				BIT2
+#define UART_CH_HOST	0x7F	// As in main.c
+#define RESUME_TICKS	4000	// Ticks after the handback, > 2 envelope cycles
+
+static unsigned char sentCh[UPDATES], sentVal[UPDATES];
+static unsigned char shadow[16];	// req[] as last seen by the hook
+static unsigned long landed, wrong, over;
+
+static void check_req(void) {
+//------------------------------------------------------------------------------
+// simHook - every change of req[] must be the next update that was sent
+//------------------------------------------------------------------------------
+	int n;
+
+	for (n = 0; n < fwChannels; ++n)
+		if (req[n] != shadow[n]) {
+			if (landed >= UPDATES || sentCh[landed] != n ||
+					sentVal[landed] != req[n])
+				++wrong;
+			++landed;
+			shadow[n] = req[n];
+		}
+}
+
+static void check_max(void) {
+//	simHook - no request above its channel's max
+	int n;
+
+	for (n = 0; n < fwChannels; ++n)
+		if (req[n] > max[n])
+			++over;
+}
+
+static void resume(void) {
+//------------------------------------------------------------------------------
+// Host takes over from the envelopes at low levels and hands back, own process
+//------------------------------------------------------------------------------
+	double bit = SIM_SMCLK / 115200.0;
+	sim_time t;
+	int n;
+
+	sim_edge(0, RXD, 1);
+	sim_reset();
+	sim_run(300);						// Envelopes well into a cycle
+	t = sim_uart_tx(simNow + SIM_TICK / 3, 0x55, bit, RXD);
+	for (n = 0; n < fwChannels; ++n) {
+		t = sim_uart_tx(t, 0x80 | n, bit, RXD);
+		t = sim_uart_tx(t, 1, bit, RXD);
+	}
+	t = sim_uart_tx(t, 0x80 | UART_CH_HOST, bit, RXD);
+	t = sim_uart_tx(t, 0, bit, RXD);
+	while (simNow < t)
+		sim_run(1);
+	simHook = check_max;
+	sim_run(RESUME_TICKS);
+
+	printf("resume: hostCtl %u, %d ticks after the handback, %lu requests "
+			"above max\n", hostCtl, RESUME_TICKS, over);
+	exit(simMissed || hostCtl || over);
+}
+
+static void run(unsigned long baud, double dcoErr) {
+//------------------------------------------------------------------------------
+// One baud rate, in its own process since the firmware boots only once
+//------------------------------------------------------------------------------
+	double bit = SIM_SMCLK * (1.0 + dcoErr) / baud;
+	unsigned char last[16];				// Value each channel will end up with
+	sim_time t;
+	int i, n, v;
+
+	sim_edge(0, RXD, 1);				// Line idle
+	sim_reset();
+	sim_run(1);
+	for (n = 0; n < fwChannels; ++n)
+		shadow[n] = last[n] = req[n];
+	hostCtl = 1;						// Keep the envelopes off req[]
+	simHook = check_req;
+
+	t = sim_uart_tx(SIM_TICK + SIM_TICK / 3, 0x55, bit, RXD);
+	srand(baud);
+	for (i = 0; i < UPDATES; ++i) {
+		n = rand() % fwChannels;
+		do								// A change, so the hook can see it
+			v = rand() % (max[n] + 1);
+		while (v == last[n]);
+		last[n] = v;
+		sentCh[i] = n;
+		sentVal[i] = v;
+		t = sim_uart_tx(t, 0x80 | n, bit, RXD);
+		t = sim_uart_tx(t, v, bit, RXD);
+	}
+	while (simNow < t)					// Ticks may vary (SPREAD_TICK)
+		sim_run(1);
+	sim_run(2);
+
+	printf("%6lu baud, DCO %+4.1f%%: %lu ticks, %lu missed, "
+			"%lu/%d updates (%lu wrong), WDT latency <= %u cycles (%.2f us)\n",
+			baud, dcoErr * 100, simTicks, simMissed, landed, UPDATES, wrong,
+			simLatency, simLatency * 1e6 / SIM_SMCLK);
+	exit(simMissed || wrong || landed != UPDATES);
+}
+
+int main(void) {
+	static const unsigned long baud[] = { 9600, 115200 };
+	static const double dcoErr[] = { -0.05, 0.0, 0.08 };
+	int b, d, status, fail = 0;
+
+	for (b = 0; b < 2; ++b)
+		for (d = 0; d < 3; ++d) {
+			fflush(stdout);
+			if (!fork())
+				run(baud[b], dcoErr[d]);
+			wait(&status);
+			fail |= !WIFEXITED(status) || WEXITSTATUS(status);
+		}
+	fflush(stdout);
+	if (!fork())
+		resume();
+	wait(&status);
+	fail |= !WIFEXITED(status) || WEXITSTATUS(status);
+
+	printf(fail ? "FAIL\n" : "PASS\n");
+	return fail;
+}
@@ -0,0 +1,258 @@
+//******************************************************************************
+//	Parameter sweep - MAX, STEPS, LOOP_SPEED and tick period, in parallel
+//
+//	Description:
+//		Every combination of the listed values is one configuration: all
+//		four channel groups get the same MAX_CH_* and STEPS_CH_* (STEPS
+//		<= MAX <= 255), with LOOP_SPEED and TICK_CYCLES, plus the extra
+//		-D given with -D. Each one is built with sim_sweep.c and run, one
+//		per thread of a pool as large as the CPU count (-j to change),
+//		and its line of figures goes into a table:
+//			tick	TICK_CYCLES
+//			loop	LOOP_SPEED
+//			max		MAX_CH_*
+//			steps	STEPS_CH_*
+//			cycle	animation period, 6 * STEPS * 2**LOOP_SPEED ticks, s
+//			busy	busiest tick, % of the shortest tick period
+//			miss	missed ticks
+//			flick	mean flicker of held levels, % (eye model of sim.c)
+//			edges	pin edges per second with the envelopes
+//			uW		their switching power (sim_sweep.c)
+//			jump	largest level change of an envelope step, %
+//			step/s	envelope steps per second
+//
+//		Results are kept in a cache file (-c, default sweep.cache), one
+//		line per configuration, keyed by its -D and by a hash of the
+//		sources the simulator is built from. A configuration already in
+//		the cache with the same hash is not simulated again; after a
+//		change to main.c or the simulator all of them are. Lines are
+//		appended as runs finish, so an interrupted sweep resumes.
+//
+//		The WDT only gives ticks of 32768 and 8192 cycles; other -t values
+//		need -D "-DSPREAD_TICK=1".
+//
+//	Build:
+//		gcc -O2 -pthread -o sweep host/sweep.c
+//	Run: (from the repository root)
+//		./sweep [-m list] [-s list] [-l list] [-t list] [-D opts]
+//			[-c cache] [-j threads]
+//		lists are comma separated, e.g. -m 100,200 -l 4,5,6
+//******************************************************************************
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_VALS		32		// Values per list
+#define KEY_LEN			256
+#define RES_LEN			128
+
+static const char *const sources[] = { "main.c", "ntf.h", "config.h",
+		"host/fw.c", "host/sim.c", "host/sim.h", "host/msp430g2211.h",
+		"host/sim_sweep.c" };
+
+typedef struct {
+	int tick, loop, max, steps;
+	char key[KEY_LEN];			// -D of this configuration
+	char res[RES_LEN];			// sim_sweep line, "" = not run or failed
+	int cached;
+} conf;
+
+static conf *confs;
+static int nConfs, next, nRun, nFailed;
+static unsigned long long srcHash;
+static char dir[] = "/tmp/sweep.XXXXXX";
+static const char *cachePath = "sweep.cache";
+static FILE *cache;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int parse_list(const char *s, int *v) {
+//	"100,150,200" into v[], returns the count
+	int n = 0;
+
+	while (*s && n < MAX_VALS) {
+		v[n++] = strtol(s, (char **)&s, 10);
+		if (*s == ',')
+			++s;
+	}
+	return n;
+}
+
+static unsigned long long hash_sources(void) {
+//	FNV-1a over the files the results depend on, missing ones count as empty
+	unsigned long long h = 0xCBF29CE484222325ULL;
+	unsigned int i;
+	FILE *f;
+	int c;
+
+	for (i = 0; i < sizeof sources / sizeof *sources; ++i) {
+		if (!(f = fopen(sources[i], "rb")))
+			continue;
+		while ((c = getc(f)) != EOF)
+			h = (h ^ (unsigned char)c) * 0x100000001B3ULL;
+		fclose(f);
+	}
+	return h;
+}
+
+static void load_cache(void) {
+//	Results of this source hash; lines of other hashes are left in the file
+	char line[16 + 1 + KEY_LEN + 1 + RES_LEN + 2], *key, *res;
+	unsigned long long h;
+	FILE *f = fopen(cachePath, "r");
+	int i;
+
+	if (!f)
+		return;
+	while (fgets(line, sizeof line, f)) {
+		line[strcspn(line, "\n")] = 0;
+		if (!(key = strchr(line, '\t')) || !(res = strchr(key + 1, '\t')))
+			continue;
+		*key++ = 0;
+		*res++ = 0;
+		h = strtoull(line, NULL, 16);
+		for (i = 0; h == srcHash && i < nConfs; ++i)
+			if (!strcmp(confs[i].key, key)) {
+				snprintf(confs[i].res, RES_LEN, "%s", res);
+				confs[i].cached = 1;
+			}
+	}
+	fclose(f);
+}
+
+static void run(conf *c, int id) {
+//------------------------------------------------------------------------------
+// Build and run one configuration, cache its line
+//------------------------------------------------------------------------------
+	char cmd[3 * KEY_LEN], line[RES_LEN];
+	FILE *p;
+
+	snprintf(cmd, sizeof cmd, "gcc -O1 -Ihost %s -o %s/sw%d host/fw.c "
+			"host/sim.c host/sim_sweep.c -lm 2>/dev/null && %s/sw%d; "
+			"rm -f %s/sw%d", c->key, dir, id, dir, id, dir, id);
+	line[0] = 0;
+	if ((p = popen(cmd, "r"))) {
+		if (!fgets(line, sizeof line, p))
+			line[0] = 0;
+		pclose(p);
+	}
+	line[strcspn(line, "\n")] = 0;
+
+	pthread_mutex_lock(&lock);
+	++nRun;
+	if (line[0]) {
+		snprintf(c->res, RES_LEN, "%s", line);
+		fprintf(cache, "%016llx\t%s\t%s\n", srcHash, c->key, line);
+		fflush(cache);
+	}
+	else
+		++nFailed;
+	pthread_mutex_unlock(&lock);
+}
+
+static void *worker(void *arg) {
+	int i;
+
+	while ((i = __sync_fetch_and_add(&next, 1)) < nConfs)
+		if (!confs[i].cached)
+			run(&confs[i], (int)(long)arg);
+	return NULL;
+}
+
+int main(int argc, char **argv) {
+	int maxV[MAX_VALS] = { 50, 100, 150, 200, 250 }, nMax = 5;
+	int stepV[MAX_VALS] = { 10, 25, 50, 100, 125, 150, 200, 250 }, nStep = 8;
+	int loopV[MAX_VALS] = { 3, 4, 5, 6, 7 }, nLoop = 5;
+	int tickV[MAX_VALS] = { 8192, 32768 }, nTick = 2;
+	const char *opts = "";
+	double busy, flick, edges, uw, jump, rate;
+	unsigned long miss;
+	int threads = sysconf(_SC_NPROCESSORS_ONLN), opt, t, l, m, s, i;
+	pthread_t *tid;
+	conf *c;
+
+	while ((opt = getopt(argc, argv, "m:s:l:t:D:c:j:")) != -1) {
+		if (opt == 'm')
+			nMax = parse_list(optarg, maxV);
+		else if (opt == 's')
+			nStep = parse_list(optarg, stepV);
+		else if (opt == 'l')
+			nLoop = parse_list(optarg, loopV);
+		else if (opt == 't')
+			nTick = parse_list(optarg, tickV);
+		else if (opt == 'D')
+			opts = optarg;
+		else if (opt == 'c')
+			cachePath = optarg;
+		else if (opt == 'j')
+			threads = atoi(optarg);
+		else
+			optind = argc + 1;
+	}
+	if (optind != argc) {
+		fprintf(stderr, "usage: sweep [-m list] [-s list] [-l list] [-t list] "
+				"[-D opts] [-c cache] [-j threads]\n");
+		return 2;
+	}
+	if (threads < 1)
+		threads = 1;
+
+	confs = calloc(nTick * nLoop * nMax * nStep, sizeof(conf));
+	for (t = 0; t < nTick; ++t)
+		for (l = 0; l < nLoop; ++l)
+			for (m = 0; m < nMax; ++m)
+				for (s = 0; s < nStep; ++s) {
+					if (stepV[s] < 1 || stepV[s] > maxV[m] || maxV[m] > 255)
+						continue;
+					c = &confs[nConfs++];
+					c->tick = tickV[t];
+					c->loop = loopV[l];
+					c->max = maxV[m];
+					c->steps = stepV[s];
+					snprintf(c->key, KEY_LEN, "-DTICK_CYCLES=%d "
+							"-DLOOP_SPEED=%d -DMAX_CH_0_2=%d -DMAX_CH_3_5=%d "
+							"-DMAX_CH_6_7=%d -DMAX_CH_8_9=%d -DSTEPS_CH_0_2=%d "
+							"-DSTEPS_CH_3_5=%d -DSTEPS_CH_6_7=%d "
+							"-DSTEPS_CH_8_9=%d%s%s", c->tick, c->loop, c->max,
+							c->max, c->max, c->max, c->steps, c->steps,
+							c->steps, c->steps, *opts ? " " : "", opts);
+				}
+
+	srcHash = hash_sources();
+	load_cache();
+	if (!(cache = fopen(cachePath, "a")) || !mkdtemp(dir)) {
+		perror("sweep");
+		return 2;
+	}
+	tid = malloc(threads * sizeof(pthread_t));
+	for (i = 0; i < threads; ++i)
+		pthread_create(&tid[i], NULL, worker, (void *)(long)i);
+	for (i = 0; i < threads; ++i)
+		pthread_join(tid[i], NULL);
+	fclose(cache);
+	rmdir(dir);
+
+	printf(" tick loop max steps  cycle s  busy %%  miss  flick %%   edges/s"
+			"     uW  jump %%  step/s\n");
+	for (i = 0; i < nConfs; ++i) {
+		c = &confs[i];
+		printf("%5d %4d %3d %5d %8.1f  ", c->tick, c->loop, c->max, c->steps,
+				6.0 * c->steps * (1 << c->loop) * c->tick / 16e6);
+		if (!c->res[0]) {
+			printf("build or run failed\n");
+			continue;
+		}
+		sscanf(c->res, "%lf %lu %lf %lf %lf %lf %lf", &busy, &miss, &flick,
+				&edges, &uw, &jump, &rate);
+		printf("%6.1f %5lu %7.3f %9.0f %6.1f %7.2f %7.1f\n", busy, miss,
+				flick, edges, uw, jump, rate);
+	}
+	printf("%d configurations on %d threads: %d cached, %d simulated, "
+			"%d failed (%s, sources %016llx)\n", nConfs, threads,
+			nConfs - nRun, nRun - nFailed, nFailed, cachePath, srcHash);
+	free(tid);
+	free(confs);
+	return nFailed != 0;
+}
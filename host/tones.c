@@ -0,0 +1,246 @@
+//******************************************************************************
+//	Idle tone analysis - exact period and low tones of every (req, max) pair
+//
+//	Description:
+//		With a constant input req/max a first-order modulator is periodic:
+//		it repeats after max/gcd(req, max) steps, from any integrator value.
+//		Its output is then a sum of tones at multiples of the tick rate over
+//		that period, and near 0, max/2, max/3 ... the period gets long and
+//		some of these tones fall where the eye sees them as flicker.
+//
+//		For every req of every resolution the configuration has, the output
+//		bits of one exact period are generated with the step of
+//		calc_output_bits(), blanked like the main loop does at dimLvl, and
+//		the amplitude of each tone below the threshold is taken from the
+//		DFT of that period. A level is flagged when one of them is larger
+//		than the floor (fraction of full brightness). Levels the envelopes
+//		pass through (multiples of their step) are counted apart, and marked
+//		with * in the -v list.
+//
+//		The resolutions are those in max[] as built, or with -a every one
+//		from 1 to 255, which FLASH_CFG and the host commands can set. The
+//		pairs are split over one thread per CPU.
+//
+//	Build:
+//		gcc -O2 -pthread -Ihost -o tones host/fw.c host/sim.c host/tones.c -lm
+//	Run:
+//		./tones [-a] [-v] [-f Hz] [-A floor] [-d dimLvl]
+//			-f tones below this frequency, default 100 Hz
+//			-A flag above this amplitude, default 0.005 (0.5 %)
+//			-d lit ticks per 256 (BLANKING builds), default 256
+//			-v list the flagged levels
+//******************************************************************************
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "msp430g2211.h"
+#include "sim.h"
+
+#define MAX_RES			255		// Largest max[] a host can set
+#define TICK_HZ			((double)SIM_SMCLK / SIM_TICK)
+
+extern const unsigned char fwInc[];
+
+typedef struct {
+	unsigned char req, max;
+	unsigned long period;		// Ticks, blanking included
+	double lowest;				// Lowest tone present, Hz (0 = constant)
+	double worstHz, worstAmp;	// Largest tone below the threshold
+} pair;
+
+static pair *pairs;
+static int nPairs, next;
+static double thresh = 100, floorAmp = 0.005;
+static unsigned int dim = 256;
+
+static unsigned long gcd(unsigned long a, unsigned long b) {
+	unsigned long t;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static void analyse(pair *p, unsigned char *bits, double *cs, double *sn) {
+//------------------------------------------------------------------------------
+// One exact period of the blanked bit stream and its tones below thresh
+//------------------------------------------------------------------------------
+	unsigned long steps, blank, lit, T, n, i, k, kMax;
+	unsigned int sum = p->max / 2, acc = 0;
+	double re, im, amp;
+
+	steps = p->max / gcd(p->req, p->max);
+	blank = 256 / gcd(dim, 256);	// Ticks before dimAcc repeats
+	lit = dim / gcd(dim, 256);		// Modulator steps in them
+	T = blank * (steps / gcd(lit, steps));
+	p->period = T;
+	p->lowest = p->worstHz = p->worstAmp = 0;
+
+	for (n = 0; n < T; ++n) {		// Main loop and calc_output_bits()
+		acc += dim;
+		bits[n] = 0;
+		if (acc & 0x100) {
+			acc &= 0xFF;
+			sum += p->req;
+			if (sum < p->max)
+				bits[n] = 1;
+			else
+				sum -= p->max;
+		}
+	}
+	for (n = 0; n < T; ++n) {
+		cs[n] = cos(2 * M_PI * n / T);
+		sn[n] = sin(2 * M_PI * n / T);
+	}
+	kMax = T / 2;
+	for (k = 1; k <= kMax; ++k) {
+		if (k * TICK_HZ / T >= thresh && p->lowest)
+			break;
+		re = im = 0;
+		for (n = i = 0; n < T; ++n, i = (i + k) % T)
+			if (bits[n]) {
+				re += cs[i];
+				im -= sn[i];
+			}
+		amp = (k == T - k ? 1 : 2) * sqrt(re * re + im * im) / T;
+		if (amp < 1e-9)
+			continue;				// Not present
+		if (!p->lowest)
+			p->lowest = k * TICK_HZ / T;
+		if (k * TICK_HZ / T < thresh && amp > p->worstAmp) {
+			p->worstAmp = amp;
+			p->worstHz = k * TICK_HZ / T;
+		}
+	}
+}
+
+static void *worker(void *arg) {
+//	Take pairs until none are left; tables sized for the longest period
+	unsigned char *bits = malloc(256 * MAX_RES);
+	double *cs = malloc(256 * MAX_RES * sizeof(double));
+	double *sn = malloc(256 * MAX_RES * sizeof(double));
+	int i;
+
+	(void)arg;
+
+	while ((i = __sync_fetch_and_add(&next, 1)) < nPairs)
+		analyse(&pairs[i], bits, cs, sn);
+	free(bits);
+	free(cs);
+	free(sn);
+	return NULL;
+}
+
+static void report(unsigned int m, int verbose) {
+//------------------------------------------------------------------------------
+// One resolution: counts and the strongest low tone, -v the flagged levels
+//------------------------------------------------------------------------------
+	unsigned int inc = 0, flagged = 0, onEnv = 0;
+	unsigned long longest = 0;
+	pair *p, *worst = NULL;
+	int i, n;
+
+	for (n = 0; n < fwChannels; ++n)
+		if (max[n] == m && (!inc || fwInc[n] < inc))
+			inc = fwInc[n];
+	for (p = pairs, i = 0; i < nPairs; ++i, ++p)
+		if (p->max == m) {
+			if (p->period > longest)
+				longest = p->period;
+			if (p->worstAmp > floorAmp) {
+				++flagged;
+				onEnv += inc && p->req % inc == 0;
+			}
+			if (!worst || p->worstAmp > worst->worstAmp)
+				worst = p;
+		}
+	printf("max %3u", m);
+	if (inc) {
+		printf(" (channels");
+		for (n = 0; n < fwChannels; ++n)
+			if (max[n] == m)
+				printf(" %d", n);
+		printf(", envelope step %u)", inc);
+	}
+	printf(": %u levels, longest period %lu ticks (%.1f Hz), %u flagged",
+			m + 1, longest, TICK_HZ / longest, flagged);
+	if (inc)
+		printf(", %u on the envelope", onEnv);
+	if (flagged)
+		printf(", worst req %u: %.1f Hz at %.2f %%", worst->req,
+				worst->worstHz, 100 * worst->worstAmp);
+	printf("\n");
+	if (!flagged || !verbose)
+		return;
+	printf("   req  period  lowest tone   worst tone below %.0f Hz\n", thresh);
+	for (p = pairs, i = 0; i < nPairs; ++i, ++p)
+		if (p->max == m && p->worstAmp > floorAmp)
+			printf("  %c%3u  %6lu  %7.2f Hz  %7.2f Hz  %5.2f %%\n",
+					inc && p->req % inc == 0 ? '*' : ' ', p->req, p->period,
+					p->lowest, p->worstHz, 100 * p->worstAmp);
+}
+
+int main(int argc, char **argv) {
+	unsigned char used[MAX_RES + 1] = { 0 };
+	int all = 0, verbose = 0, opt, n, threads, m, r, total = 0;
+	pthread_t *tid;
+
+	while ((opt = getopt(argc, argv, "avf:A:d:")) != -1) {
+		if (opt == 'a')
+			all = 1;
+		else if (opt == 'v')
+			verbose = 1;
+		else if (opt == 'f')
+			thresh = atof(optarg);
+		else if (opt == 'A')
+			floorAmp = atof(optarg);
+		else if (opt == 'd')
+			dim = atoi(optarg);
+		else
+			optind = argc + 1;
+	}
+	if (optind != argc || thresh <= 0 || dim < 1 || dim > 256) {
+		fprintf(stderr, "usage: tones [-a] [-v] [-f Hz] [-A floor] "
+				"[-d dimLvl]\n");
+		return 2;
+	}
+	for (n = 0; n < fwChannels; ++n)
+		used[max[n]] = 1;
+	for (m = 1; m <= MAX_RES; ++m)
+		if (all || used[m])
+			nPairs += m + 1;
+	pairs = malloc(nPairs * sizeof(pair));
+	for (m = 1, n = 0; m <= MAX_RES; ++m)
+		for (r = 0; (all || used[m]) && r <= m; ++r, ++n) {
+			pairs[n].req = r;
+			pairs[n].max = m;
+		}
+
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads < 1)
+		threads = 1;
+	tid = malloc(threads * sizeof(pthread_t));
+	for (n = 0; n < threads; ++n)
+		pthread_create(&tid[n], NULL, worker, NULL);
+	for (n = 0; n < threads; ++n)
+		pthread_join(tid[n], NULL);
+
+	printf("%d pairs on %d threads, tick %.1f Hz, %u of 256 ticks lit, "
+			"flagged: a tone below %.0f Hz over %.2f %%\n", nPairs, threads,
+			TICK_HZ, dim, thresh, 100 * floorAmp);
+	for (m = 1; m <= MAX_RES; ++m)
+		if (all || used[m])
+			report(m, verbose);
+	for (n = 0; n < nPairs; ++n)
+		total += pairs[n].worstAmp > floorAmp;
+	printf("%d of %d levels flagged\n", total, nPairs);
+	free(tid);
+	free(pairs);
+	return 0;
+}
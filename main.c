@@ -42,6 +42,77 @@
 //		P2.6 - RG_LED_2 Red bit		(100 ohm, common cathode)
 //		P2.7 - RG_LED_2 Green bit	(100 ohm, common cathode)
 //
+//	Options: (each one is a #define below, 0 = off)
+//		SOFT_UART	- 8N1 software UART on P1.2 (LaunchPad RXD), see
+//					  uart_rx() and frame_rx(). P1.2 becomes an input,
+//					  RGB_LED_1 Blue is lost.
+//		I2C_SLAVE	- bit-banged I2C slave, SCL on P1.6 and SDA on P1.7, see
+//					  i2c_read() for the registers. RG_LED_1 is lost. The
+//					  master must support clock stretching and run at 50 kHz
+//					  or less; faster transfers are dropped, see Port_1().
+//		SD_ADC		- first-order delta-sigma ADC with Comparator_A+, see
+//					  calc_adc(). The result sets the envelope speed.
+//					  RGB_LED_2 Green and Blue are lost.
+//		AMBIENT_DIM	- dims all LED's to the room light measured by SD_ADC
+//					  (needs it, and the envelope speed stays fixed), see
+//					  calc_dim(). Use an LDR from Vcc and a resistor to GND
+//					  as the analog input.
+//		CAP_TOUCH	- touch pad on P1.1 (bare copper or a wire, no other
+//					  parts), see calc_touch(). A tap selects the next
+//					  animation program, holding it steps the brightness.
+//					  RGB_LED_1 Green is lost.
+//		FLASH_CFG	- channel resolutions (max[]) and, with CAP_TOUCH, the
+//					  program and brightness kept in INFO flash across
+//					  power cycles, see cfg_load() and cfg_step(). A host
+//					  sets max[] with UART channels 0x40 + n or I2C
+//					  registers 0x30 + n, no lower than MAX_CH_* as the
+//					  envelopes step up to it.
+//		DITHER		- the quantizer threshold of each modulator is moved by
+//					  a pseudo-random amount every tick (LFSR), which breaks
+//					  up the long output patterns of levels near 0, 1/2 ...
+//					  of max (idle tones, see host/tones.c) into noise. The
+//					  average is not changed. See calc_output_bits().
+//		SPREAD_TICK	- the tick comes from Timer_A CCR0 instead of the WDT,
+//					  with a pseudo-random period of TICK_CYCLES +-1/8
+//					  (mean unchanged), so the pin edges no longer sit on
+//					  a fixed grid and their emissions are spread instead
+//					  of piling up on the tick harmonics. See Timer_A0().
+//					  Not with CAP_TOUCH, which captures with CCR0.
+//		NTF_SHAPED	- higher order modulators (MOD_DS2 for every group):
+//					  the quantization error is fed back through the
+//					  shift-only loop in ntf.h, which moves the noise above
+//					  the frequencies the eye sees; first order near 0 and
+//					  max, where one output bit would overload it. ntf.h is
+//					  generated by host/ntf.c. Not with DITHER.
+//		SWITCH_LIMIT - at most this many LED pins change on one tick; the
+//					  rest keep their level a tick longer and the lit (or
+//					  dark) tick they missed is given back later, so the
+//					  averages stay exact. Lowers the supply current steps
+//					  and ground bounce when many channels flip together.
+//					  See limit_switching().
+//		MOD_CH_0_2	- modulation policy of each channel group (and
+//					  MOD_CH_3_5, MOD_CH_6_7, MOD_CH_8_9): MOD_DS1 first
+//					  order delta-sigma (default), MOD_DS2 noise shaped by
+//					  ntf.h, MOD_PWM one pulse per max ticks (as in
+//					  main-only-compare-waveforms.c, host/compare.c puts
+//					  both side by side), MOD_PDM the same lit ticks spread
+//					  by a bit-reversed counter, MOD_BAM binary weighted
+//					  slots. PDM and BAM need max = 2**B - 1. All keep the
+//					  average 1 - req/max. See calc_output_bits().
+//		GEN_CONFIG	- MAX_CH_*, STEPS_CH_*, LOOP_SPEED and TICK_CYCLES (and
+//					  SPREAD_TICK if needed) from config.h, which
+//					  host/confgen.c writes from flicker, fade time and CPU
+//					  targets, instead of the values below.
+//		GEN_SHOW	- envelopes from the key table of show.h, which
+//					  host/showc.c compiles from the ramp and hold steps of
+//					  show.txt; the build checks that every level fits max.
+//					  See calc_show().
+//
+//	SD_ADC wiring: (R = 100k, C = 1u, a smaller R*C adds linearity error)
+//		P1.5 --R--+--R-- analog input (potentiometer wiper, LDR divider)
+//		          |
+//		P1.4 -----+--C-- GND
+//
 //	Bibliography:
 //		Jason Sachs, Modulation Alternatives for the Software Engineer
 //		http://www.embeddedrelated.com/showarticle/107.php
@@ -54,6 +125,16 @@
 
 #include "msp430g2211.h"
 
+#ifndef GEN_CONFIG
+#define GEN_CONFIG		0		// 1 = settings below from config.h
+#endif
+#if GEN_CONFIG
+#include "config.h"
+#endif
+#ifndef GEN_SHOW
+#define GEN_SHOW		0		// 1 = envelopes from show.h, see calc_show()
+#endif
+
 //------------------------------------------------------------------------------
 // Hardware related definitions
 //------------------------------------------------------------------------------
@@ -62,46 +143,458 @@
 
 #define N_CH			10		// Number of modulator channels
 
+#ifndef LOOP_SPEED
 #define LOOP_SPEED		6		// Calc envelope on each 2**LOOP_SPEED interrupts
+#endif
+
+#ifndef SOFT_UART
+#define SOFT_UART		0		// 1 = receive req[] updates from a host on P1.2
+#endif
+#define UART_RXD		BIT2	// P1.2 = TA0.1 input (CCI1A)
+#define UART_SYNC		0x55	// Autobaud char, falling edges 8 bits apart
+#define UART_CH_IDLE	0xFF	// uartCh value when no command is pending
+#define UART_CH_HOST	0x7F	// Command channel that writes hostCtl
+#define UART_CH_FRAME	0x7E	// Command channel that starts a frame
+#define UART_CH_HUNT	0xFE	// uartCh after a bad frame, wait for a frame
+#define UART_CH_MAX		0x40	// Command channels 0x40 + n write max[n]
+
+#define FRM_MAP_LO		0x80	// frmPos: next byte is the bitmap low byte,
+#define FRM_MAP_HI		0x81	//   the bitmap high byte,
+#define FRM_CRC			0x82	//   the CRC, else a value for channel frmPos
+
+#ifndef I2C_SLAVE
+#define I2C_SLAVE		0		// 1 = I2C slave on P1.6 (SCL) and P1.7 (SDA)
+#endif
+#define I2C_ADDR		0x48	// 7 bit slave address, change for each board
+#define I2C_SCL			BIT6	// Open drain: P1OUT = 0, P1DIR = 1 pulls low
+#define I2C_SDA			BIT7
+
+#define I2C_REG_REQ		0x00	// req[0..N_CH-1]
+#define I2C_REG_HOST	0x10	// hostCtl, 0 = envelopes drive req[]
+#define I2C_REG_STATS	0x20	// tickCnt low, tickCnt high, lateCnt, errCnt
+#define I2C_REG_MAX		0x30	// max[0..N_CH-1], low byte
+
+#define I2C_IDLE		0		// Not addressed, wait for a START
+#define I2C_ADDR_BYTE	1		// Receiving the address byte
+#define I2C_REG_BYTE	2		// Receiving the register pointer
+#define I2C_WRITE		3		// Receiving data bytes
+#define I2C_READ		4		// Sending data bytes
+
+#ifndef SD_ADC
+#define SD_ADC			0		// 1 = analog input on P1.4, feedback on P1.5
+#endif
+#define ADC_IN			BIT4	// P1.4 = CA4, integrator capacitor
+#define ADC_FB			BIT5	// P1.5, 1-bit DAC driving the integrator
+#define ADC_OSR			128		// Decimation ratio, ticks per conversion
+
+#ifndef AMBIENT_DIM
+#define AMBIENT_DIM		0		// 1 = brightness follows adcVal, needs SD_ADC
+#endif
+#define DIM_MIN			16		// Darkest level, 256 = full brightness
+#define DIM_TC			4		// Filter time constant, 2**DIM_TC conversions
+
+#if AMBIENT_DIM && !SD_ADC
+#error "AMBIENT_DIM needs the SD_ADC light sensor"
+#endif
+#if SD_ADC && !AMBIENT_DIM
+#define LOOP_SPEED_MAX	7		// envPhase shifts by 7 - LOOP_SPEED
+#else
+#define LOOP_SPEED_MAX	14		// intCnt tests bit LOOP_SPEED of an int
+#endif
+#if SD_ADC && !AMBIENT_DIM && LOOP_SPEED > 7
+#error "SD_ADC shifts the envelope speed by 7 - LOOP_SPEED, so LOOP_SPEED <= 7"
+#elif LOOP_SPEED > LOOP_SPEED_MAX
+#error "intCnt is a 16 bit int, LOOP_SPEED must be <= 14"
+#endif
+
+#ifndef CAP_TOUCH
+#define CAP_TOUCH		0		// 1 = touch pad on P1.1 switches programs
+#endif
+#define TOUCH_PAD		BIT1	// P1.1 = TA0.0 output and CCI0A capture input
+#define TOUCH_CAPTURE	(OUT + SCS + CM_2 + CAP)	// Falling edge, pin high
+#define TOUCH_MAX		255		// Discharge time limit, cycles (pad shorted)
+#define TOUCH_AVG		3		// Filter time constant, 2**TOUCH_AVG ticks
+#define TOUCH_ON		(2 << TOUCH_AVG)	// Finger slows the discharge by 2
+#define TOUCH_OFF		(1 << TOUCH_AVG)	//   cycles, released below 1
+#define TOUCH_MIN		MS_TICKS(20)	// Shortest tap, ticks
+#define TOUCH_LONG		MS_TICKS(500)	// Hold time per brightness step, ticks
+#define TOUCH_DIMS		4		// Brightness levels, each half the previous
+
+#define PROG_CYCLE		0		// Animation programs: colour envelopes,
+#define PROG_FAST		1		//   4 times faster,
+#define PROG_HOLD		2		//   current colours held
+#define N_PROG			3
+
+#define BLANKING		(AMBIENT_DIM || CAP_TOUCH)	// Ticks blanked to dim
+
+#ifndef FLASH_CFG
+#define FLASH_CFG		0		// 1 = settings saved in INFO flash D ... B
+#endif
+#ifndef INFO_D
+#define INFO_D			((unsigned char *)0x1000)	// Segments D, C, B, A
+#endif
+#define CFG_SEGS		3		// D, C and B; A holds the DCO calibration
+#define CFG_SEG_SIZE	64
+#define CFG_REC			16		// Record: seq, max[], prog, dim, unused, sum
+#define CFG_PER_SEG		(CFG_SEG_SIZE / CFG_REC)
+#define CFG_SLOTS		(CFG_SEGS * CFG_PER_SEG)
+#define CFG_PROG		(N_CH + 1)	// Record offsets
+#define CFG_DIM			(N_CH + 2)
+#define CFG_SUM			(CFG_REC - 1)
+#define CFG_DELAY		MS_TICKS(2000)	// Ticks without a change before a save
+#define CFG_FN			39		// Flash clock MCLK / (CFG_FN + 1) = 400 kHz
+#define CFG_MAX_MIN(n)	((n) < 3 ? MAX_CH_0_2 : (n) < 6 ? MAX_CH_3_5 : \
+							(n) < 8 ? MAX_CH_6_7 : MAX_CH_8_9)	// Of max[n]
+
+#ifndef DITHER
+#define DITHER			0		// 1 = dithered modulator thresholds
+#endif
+#define DITHER_MASK		0x3F	// Threshold is max + 0 ... DITHER_MASK
+#define DITHER_TAPS		0xB400	// Galois LFSR, x^16 + x^14 + x^13 + x^11 + 1
+#define DITHER_MID		(DITHER ? DITHER_MASK / 2 : 0)	// Mean threshold - max
+
+#ifndef NTF_SHAPED
+#define NTF_SHAPED		0		// 1 = noise shaping loop of ntf.h everywhere
+#endif
+
+#define MOD_DS1			1		// Modulation policies, see calc_output_bits()
+#define MOD_DS2			2
+#define MOD_PWM			3
+#define MOD_PDM			4
+#define MOD_BAM			5
+#if NTF_SHAPED
+#define MOD_DEFAULT		MOD_DS2
+#else
+#define MOD_DEFAULT		MOD_DS1
+#endif
+#ifndef MOD_CH_0_2
+#define MOD_CH_0_2		MOD_DEFAULT	// Policy of each channel group
+#endif
+#ifndef MOD_CH_3_5
+#define MOD_CH_3_5		MOD_DEFAULT
+#endif
+#ifndef MOD_CH_6_7
+#define MOD_CH_6_7		MOD_DEFAULT
+#endif
+#ifndef MOD_CH_8_9
+#define MOD_CH_8_9		MOD_DEFAULT
+#endif
+#define MOD_USED(p)		(MOD_CH_0_2 == (p) || MOD_CH_3_5 == (p) || \
+							MOD_CH_6_7 == (p) || MOD_CH_8_9 == (p))
+#define MOD_ALL(p)		(MOD_CH_0_2 == (p) && MOD_CH_3_5 == (p) && \
+							MOD_CH_6_7 == (p) && MOD_CH_8_9 == (p))
+
+#if MOD_USED(MOD_DS2)
+#include "ntf.h"
+#if DITHER
+#error "MOD_DS2 (NTF_SHAPED) and DITHER both move the quantizer input, pick one"
+#endif
+#endif
+
+#ifndef SWITCH_LIMIT
+#define SWITCH_LIMIT	0		// Most LED pins changing per tick, 0 = no limit
+#endif
+
+#ifndef SPREAD_TICK
+#define SPREAD_TICK		0		// 1 = Timer_A tick with a jittered period
+#endif
+#ifndef TICK_CYCLES
+#define TICK_CYCLES		8192	// Tick period in SMCLK cycles, mean with spread
+#endif
+#define MS_TICKS(ms)	((unsigned int)(((ms) * 16000UL + TICK_CYCLES - 1) \
+							/ TICK_CYCLES))	// Ticks at 16 MHz, rounded up
+#if TICK_CYCLES == 32768
+#define WDT_TICK		WDT_MDLY_32		// 32ms/16
+#elif TICK_CYCLES == 8192
+#define WDT_TICK		WDT_MDLY_8		// 8ms/16
+#elif !SPREAD_TICK
+#error "The WDT ticks every 32768 or 8192 cycles, others need SPREAD_TICK"
+#endif
+#define SPREAD_RANGE	(TICK_CYCLES / 4 / 256 * 256)	// Spread, 256 steps
+#define SPREAD_MIN		(TICK_CYCLES - (SPREAD_RANGE - SPREAD_RANGE / 256) / 2)
+#if SPREAD_TICK && SPREAD_RANGE < 256
+#error "SPREAD_TICK needs a TICK_CYCLES of 1024 or more for steps of a cycle"
+#endif
+
+#if SPREAD_TICK && CAP_TOUCH
+#error "SPREAD_TICK needs CCR0, which CAP_TOUCH uses to capture"
+#endif
+
+#define P1_LEDS			(0xFF & ~(SOFT_UART ? UART_RXD : 0) \
+							& ~(CAP_TOUCH ? TOUCH_PAD : 0) \
+							& ~(I2C_SLAVE ? I2C_SCL + I2C_SDA : 0) \
+							& ~(SD_ADC ? ADC_IN : 0))
+#define SW_MASK			((P1_LEDS & ~(SD_ADC ? ADC_FB : 0)) | 0x0300)	// LEDs
 
 //------------------------------------------------------------------------------
-// Delta-Sigma related definitions	// STEPS must be <= MAX
+// Delta-Sigma related definitions
 //------------------------------------------------------------------------------
+#ifndef MAX_CH_0_2		// Each one can be set with -D (host/sweep.c), <= 255
 #define MAX_CH_0_2		200	// Distinct possible steps between 0-100%
+#endif
+#ifndef MAX_CH_3_5
 #define MAX_CH_3_5		200	// Distinct possible steps between 0-100%
+#endif
+#ifndef MAX_CH_6_7
 #define MAX_CH_6_7		100	// Distinct possible steps between 0-100%
+#endif
+#ifndef MAX_CH_8_9
 #define MAX_CH_8_9		150	// Distinct possible steps between 0-100%
+#endif
 
+#ifndef STEPS_CH_0_2
 #define STEPS_CH_0_2		100		    // Nr of equidistant used steps
+#endif
 #define INC_CH_0_2		MAX_CH_0_2/STEPS_CH_0_2	// Increment for one step
 
+#ifndef STEPS_CH_3_5
 #define STEPS_CH_3_5		100			// Nr of equidistant used steps
+#endif
 #define INC_CH_3_5		MAX_CH_3_5/STEPS_CH_3_5	// Increment for one step
 
+#ifndef STEPS_CH_6_7
 #define STEPS_CH_6_7		50			// Nr of equidistant used steps
+#endif
 #define INC_CH_6_7		MAX_CH_6_7/STEPS_CH_6_7	// Increment for one step
 
+#ifndef STEPS_CH_8_9
 #define STEPS_CH_8_9		150			// Nr of equidistant used steps
+#endif
 #define INC_CH_8_9		MAX_CH_8_9/STEPS_CH_8_9	// Increment for one step
 
+#if MAX_CH_0_2 > 255 || MAX_CH_3_5 > 255 || MAX_CH_6_7 > 255 || MAX_CH_8_9 > 255
+#error "req[] is a byte, MAX_CH_* must be <= 255"
+#endif
+#if STEPS_CH_0_2 < 1 || STEPS_CH_0_2 > MAX_CH_0_2 || STEPS_CH_3_5 < 1 || \
+		STEPS_CH_3_5 > MAX_CH_3_5 || STEPS_CH_6_7 < 1 || \
+		STEPS_CH_6_7 > MAX_CH_6_7 || STEPS_CH_8_9 < 1 || \
+		STEPS_CH_8_9 > MAX_CH_8_9
+#error "STEPS_CH_* must be 1 ... MAX_CH_*, or INC_CH_* is 0"
+#endif
+
+#define MOD_BINARY(p, m)	(((p) == MOD_PDM || (p) == MOD_BAM) && \
+							((m) & ((m) + 1)))
+#if MOD_BINARY(MOD_CH_0_2, MAX_CH_0_2) || MOD_BINARY(MOD_CH_3_5, MAX_CH_3_5) || \
+		MOD_BINARY(MOD_CH_6_7, MAX_CH_6_7) || MOD_BINARY(MOD_CH_8_9, MAX_CH_8_9)
+#error "MOD_PDM and MOD_BAM need a MAX_CH_* of 2**B - 1 (7, 15, 31 ... 255)"
+#endif
+
+#if GEN_SHOW
+#define SHOW_INC(from, to, n)	((unsigned char)(((to) - (from)) / (n)))
+#include "show.h"				// REQ_CH_*, keys, checks of MAX and STEPS
+#else
+#define REQ_CH_0		MAX_CH_0_2	// Initial RGB_LED_1 Red value
+#define REQ_CH_1		0			// Initial RGB_LED_1 Green value
+#define REQ_CH_2		0			// Initial RGB_LED_1 Blue value
+#define REQ_CH_3		0			// Initial RGB_LED_2 Red value
+#define REQ_CH_4		MAX_CH_3_5	// Initial RGB_LED_2 Green value
+#define REQ_CH_5		MAX_CH_3_5	// Initial RGB_LED_2 Blue value
+#define REQ_CH_6		0			// Initial RG_LED_1 Red value
+#define REQ_CH_7		0			// Initial RG_LED_1 Green value
+#define REQ_CH_8		MAX_CH_8_9	// Initial RG_LED_2 Red value
+#define REQ_CH_9		MAX_CH_8_9	// Initial RG_LED_2 Green value
+#endif
+
+// Initial modulator state, computed by the compiler: each integrator starts
+// half full, which keeps the running error within +-1/2 step from the first
+// tick, and has already made its first step, whose bit is in outBits.
+// With DITHER the middle of the threshold range stands in for the threshold.
+// With MOD_DS2 the first step has no error to feed back and is the same;
+// its error starts the history. The other policies start anywhere in their
+// period.
+#define PRE_ACC(r, m)	((m) / 2 + DITHER_MID + (r))	// After the first add
+#define PRE_SUM(r, m)	(PRE_ACC(r, m) < (m) + DITHER_MID ? PRE_ACC(r, m) : \
+							PRE_ACC(r, m) - (m))
+#define PRE_BIT(r, m, n)	((unsigned int)(PRE_ACC(r, m) < (m) + DITHER_MID) \
+							<< (n))
+#define PRE_ERR(r, m)	{ PRE_ACC(r, m) < (m) ? -(r) : (m) - (r) }
+
+//------------------------------------------------------------------------------
+// Global variables used for each software channel of a Delta-Sigma modulator,
+// initialized from flash with the rest of .data by the C startup
+//------------------------------------------------------------------------------
+unsigned int max[N_CH] = {	// Maxim level (resolution) for each channel
+	MAX_CH_0_2, MAX_CH_0_2, MAX_CH_0_2, MAX_CH_3_5, MAX_CH_3_5, MAX_CH_3_5,
+	MAX_CH_6_7, MAX_CH_6_7, MAX_CH_8_9, MAX_CH_8_9 };
+unsigned char req[N_CH] = {	// Requested levels, 0 <= req <= max
+	REQ_CH_0, REQ_CH_1, REQ_CH_2, REQ_CH_3, REQ_CH_4, REQ_CH_5,
+	REQ_CH_6, REQ_CH_7, REQ_CH_8, REQ_CH_9 };
+#if MOD_USED(MOD_DS2)
+int ntfErr[N_CH][NTF_ORDER] = {	// Quantizer errors, newest first, see ntf.h
+	PRE_ERR(REQ_CH_0, MAX_CH_0_2), PRE_ERR(REQ_CH_1, MAX_CH_0_2),
+	PRE_ERR(REQ_CH_2, MAX_CH_0_2), PRE_ERR(REQ_CH_3, MAX_CH_3_5),
+	PRE_ERR(REQ_CH_4, MAX_CH_3_5), PRE_ERR(REQ_CH_5, MAX_CH_3_5),
+	PRE_ERR(REQ_CH_6, MAX_CH_6_7), PRE_ERR(REQ_CH_7, MAX_CH_6_7),
+	PRE_ERR(REQ_CH_8, MAX_CH_8_9), PRE_ERR(REQ_CH_9, MAX_CH_8_9) };
+#endif
+#if !MOD_ALL(MOD_DS2)
+unsigned int sum[N_CH] = {	// Integrators value, 0 <= sum < 2*sum
+	PRE_SUM(REQ_CH_0, MAX_CH_0_2), PRE_SUM(REQ_CH_1, MAX_CH_0_2),
+	PRE_SUM(REQ_CH_2, MAX_CH_0_2), PRE_SUM(REQ_CH_3, MAX_CH_3_5),
+	PRE_SUM(REQ_CH_4, MAX_CH_3_5), PRE_SUM(REQ_CH_5, MAX_CH_3_5),
+	PRE_SUM(REQ_CH_6, MAX_CH_6_7), PRE_SUM(REQ_CH_7, MAX_CH_6_7),
+	PRE_SUM(REQ_CH_8, MAX_CH_8_9), PRE_SUM(REQ_CH_9, MAX_CH_8_9) };
+#endif
+
+unsigned int outBits =		// Each bit store the output value of one modulator
+	PRE_BIT(REQ_CH_0, MAX_CH_0_2, 0) | PRE_BIT(REQ_CH_1, MAX_CH_0_2, 1) |
+	PRE_BIT(REQ_CH_2, MAX_CH_0_2, 2) | PRE_BIT(REQ_CH_3, MAX_CH_3_5, 3) |
+	PRE_BIT(REQ_CH_4, MAX_CH_3_5, 4) | PRE_BIT(REQ_CH_5, MAX_CH_3_5, 5) |
+	PRE_BIT(REQ_CH_6, MAX_CH_6_7, 6) | PRE_BIT(REQ_CH_7, MAX_CH_6_7, 7) |
+	PRE_BIT(REQ_CH_8, MAX_CH_8_9, 8) | PRE_BIT(REQ_CH_9, MAX_CH_8_9, 9);
+#if DITHER
+unsigned int ditherRnd = 1;	// LFSR, one step per channel and tick
+#endif
+#if SPREAD_TICK
+unsigned int tickRnd;		// LCG, one step per tick, top byte = period
+#endif
+#if SWITCH_LIMIT
+unsigned int swPrev;		// Frame on the pins, outBits of the last tick
+unsigned int swOwedOn;		// Channels owed a lit tick (held dark),
+unsigned int swOwedOff;		//   owed a dark tick (held lit)
+unsigned int swFirst = 1;	// Channel deferred first, rotates
+#endif
+unsigned char hostCtl;		// 1 = req[] owned by a host, envelopes paused
+#if SOFT_UART || I2C_SLAVE
+unsigned char envReq[N_CH];	// Envelope req[] while a host owns req[]
+#endif
+
+unsigned int tickCnt;		// WDT interrupts since reset
+unsigned int doneTick;		// tickCnt when the main loop last finished a pass
+unsigned char lateCnt;		// Ticks the main loop was too busy to serve
+unsigned char errCnt;		// Host link errors (UART framing, bad I2C register)
+
+#if SOFT_UART
 //------------------------------------------------------------------------------
-// Global variables used for each software channel of a Delta-Sigma modulator
+// Software UART receiver state
 //------------------------------------------------------------------------------
-unsigned int max[N_CH];		// Maxim level (resolution) for each channel
-unsigned char req[N_CH];	// Requested levels, 0 <= req <= max
-unsigned int sum[N_CH];		// Integrators value, 0 <= sum < 2*sum
+unsigned int uartBit;		// Bit length in SMCLK cycles, 0 = autobaud pending
+unsigned int uartT0;		// Timer_A value of the first autobaud edge
+unsigned char uartCnt;		// Bits (or autobaud edges) left in this char
+unsigned char uartByte;		// Received bits, LSB first
+unsigned char uartCh = UART_CH_IDLE;	// Channel selected by a command byte
 
-unsigned int outBits;		// Each bit store the output value of one modulator
+unsigned int frmMap;		// Channels carried by the frame
+unsigned int frmBits;		// frmMap bits still to come, bit 0 = frmPos
+unsigned char frmPos;		// FRM_MAP_LO ... FRM_CRC or channel of next value
+unsigned char frmCrc;		// CRC-8 of the frame so far
+unsigned char frmVal[N_CH];	// Checked values wait here for frame_commit()
+unsigned char frmReady;		// 1 = frame checked, not yet in req[]
+const unsigned char crcNib[16] = {	// CRC-8 (x^8+x^2+x+1) of each nibble
+	0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+	0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D };
+#endif
+
+#if I2C_SLAVE
+//------------------------------------------------------------------------------
+// I2C slave state
+//------------------------------------------------------------------------------
+unsigned char i2cState;		// I2C_IDLE ... I2C_READ
+unsigned char i2cBits;		// SCL rising edges in this byte, 9 = ACK clock
+unsigned char i2cByte;		// Shift register, MSB first
+unsigned char i2cReg;		// Register pointer, incremented on each byte
+unsigned char i2cHeld;		// SCL held low until the main loop pass is done
+#endif
+
+#if SD_ADC
+//------------------------------------------------------------------------------
+// Delta-sigma ADC state, sinc2 (CIC) decimation filter
+//------------------------------------------------------------------------------
+unsigned int adcI1, adcI2;	// Integrators, wrap around by design
+unsigned int adcD1, adcD2;	// Comb delays
+unsigned char adcCnt;		// Ticks in the current conversion
+unsigned char adcVal;		// Last conversion, 0 = 0V ... 255 = Vcc
+#if !AMBIENT_DIM
+unsigned int envPhase;		// Envelope step accumulator, bit 15 = step
+#endif
+#endif
+
+#if BLANKING
+//------------------------------------------------------------------------------
+// Dimming, one scale factor shared by all channels
+//------------------------------------------------------------------------------
+unsigned int dimLvl = 256;	// Lit ticks per 256, DIM_MIN ... 256
+unsigned int dimAcc;		// Blanking modulator integrator
+#endif
+#if AMBIENT_DIM
+unsigned int dimFilt = 256 << DIM_TC;	// Filtered light level << DIM_TC
+#endif
+
+#if CAP_TOUCH
+//------------------------------------------------------------------------------
+// Capacitive touch state
+//------------------------------------------------------------------------------
+unsigned int touchT0;		// TAR when the pad was released
+unsigned int touchAvg;		// Discharge time << TOUCH_AVG, filtered
+unsigned int touchBase;		// touchAvg with no finger, 0 = not calibrated
+unsigned int touchCnt;		// Ticks the pad has been touched
+unsigned char touchLong;	// 1 = held for brightness, no tap on release
+unsigned char touchProg;	// Animation program, PROG_CYCLE ... N_PROG-1
+unsigned char touchDim;		// Brightness level, 0 = full
+const unsigned char progSteps[N_PROG] = { 1, 4, 0 };	// Envelope steps
+#endif
+
+#if FLASH_CFG
+//------------------------------------------------------------------------------
+// Configuration log in INFO flash
+//------------------------------------------------------------------------------
+unsigned int cfgWait;		// Ticks until the next save, 0 = saved
+unsigned char cfgSlot;		// Record slot written next, 0 ... CFG_SLOTS-1
+unsigned char cfgLeft;		// Slots erased and free until the next boot
+unsigned char cfgPos;		// Byte of the record written next, 0 = idle
+unsigned char cfgSeq;		// Sequence number of the newest record
+unsigned char cfgSum;		// Checksum of the record so far
+#endif
 
 //------------------------------------------------------------------------------
 // Function prototypes
 //------------------------------------------------------------------------------
-void init_all_CH_arrays();
+#if GEN_SHOW
+void calc_show();
+#else
 void calc_CH_0_TO_2();
 void calc_CH_3_TO_5();
 void calc_CH_6_TO_7();
 void calc_CH_8_TO_9();
+#endif
 void calc_output_bits();
+#if SWITCH_LIMIT
+void limit_switching();
+#endif
+#if SOFT_UART || I2C_SLAVE
+void host_ctl(unsigned char on);
+#endif
+#if SOFT_UART
+void init_uart();
+void uart_rx(unsigned char c);
+void frame_rx(unsigned char c);
+void frame_commit();
+#endif
+#if I2C_SLAVE
+void init_i2c();
+void i2c_scl_low();
+unsigned char i2c_read(unsigned char reg);
+void i2c_write(unsigned char reg, unsigned char val);
+#endif
+#if SD_ADC
+void init_adc();
+void calc_adc();
+#endif
+#if AMBIENT_DIM
+void calc_dim();
+#endif
+#if CAP_TOUCH
+void init_touch();
+void calc_touch();
+#endif
+#if FLASH_CFG
+void cfg_load();
+void cfg_step();
+void cfg_changed();
+void cfg_max(unsigned char n, unsigned char val);
+void flash_write(unsigned char *p, unsigned char val);
+void flash_erase(unsigned char *p);
+#endif
 
 
 
@@ -109,71 +602,162 @@ void main(void) {
 //------------------------------------------------------------------------------
 // main()
 //------------------------------------------------------------------------------
+#if !SD_ADC || AMBIENT_DIM
 	volatile int intCnt;			// WDT interrupt counter
+#endif
+#if CAP_TOUCH
+	unsigned char step;				// Envelope steps left in this tick
+#endif
 
 	WDTCTL = WDTPW + WDTHOLD;		// Stop watchdog timer
 
 	DCOCTL |= DCO2;					// DCO ~ 16 MHz?
 	BCSCTL1 |= RSEL3;				// DCO ~ 16 MHz?
 
-	P1OUT = 0x00;					// Initialize P1OUT
-	P1DIR = 0xFF;					// Set all P1 pins as outputs
+	P1OUT = (outBits ^ P1_COMM_ANOD) & P1_LEDS;	// First frame of the
+	P1DIR = P1_LEDS;				//   initial state, LED pins as outputs
 
-	P2OUT = 0x00;					// Initialize P2OUT
+	P2OUT = (outBits >> 2) ^ P2_COMM_ANOD;	// Same for P2
 	P2SEL = 0x00;					// Set all P2 pins as outputs
 	P2DIR = 0xFF;					// Set all P2 pins as outputs
 
-	WDTCTL = WDT_MDLY_8;			// Start WDT+ in timer mode, 8ms/16
+#if SPREAD_TICK
+	TACTL = TASSEL_2 + MC_2;		// SMCLK, continuous mode
+	TACCR0 = TICK_CYCLES;			// First tick as with the WDT
+	TACCTL0 = CCIE;					// Compare mode, interrupt
+#else
+	WDTCTL = WDT_TICK;				// Start WDT+ in timer mode
 	IE1 |= WDTIE;					// Enable WDT+ interrupts
+#endif
 
-	init_all_CH_arrays();			// Initialize modulators
+#if FLASH_CFG
+	cfg_load();						// Saved settings, before the first tick
+#endif
+#if SOFT_UART
+	init_uart();					// Start listening for a host on P1.2
+#endif
+#if I2C_SLAVE
+	init_i2c();						// Release the bus, wait for a START
+#endif
+#if SD_ADC
+	init_adc();						// Comparator on, first conversion
+#endif
+#if CAP_TOUCH
+	init_touch();					// Timer_A on, pad released
+#endif
 
+#if SWITCH_LIMIT
+	swPrev = outBits;				// First frame, on the pins
+#endif
 	__enable_interrupt();			// Global interrupt enable
 
 	for(;;) {						// Infinite main loop
 		LPM0;						// Wait for a WDT+ interrupt
+#if SOFT_UART
+		if (frmReady)
+			frame_commit();			// Frame done while we slept
+		if (tickCnt == doneTick)
+			continue;				// Woken by frame_rx(), not by a tick
+#endif
 
+#if SD_ADC && !AMBIENT_DIM
+		envPhase += (adcVal + 1) << (7 - LOOP_SPEED);	// Envelope speed from
+		if (envPhase & 0x8000) {	//   the ADC, full scale = every
+			envPhase &= 0x7FFF;		//   2**LOOP_SPEED interrupts
+#else
 		if (++intCnt & (1 << LOOP_SPEED)) {	// Color envelope calculation for
 			intCnt = 0;			//   every 2**LOOP_SPEED interrupts
-			calc_CH_0_TO_2();		// Calculate next RGB_LED_1 color
-			calc_CH_3_TO_5();		// Calculate next RGB_LED_2 color
-			calc_CH_6_TO_7();		// Calculate next RG_LED_1 color
-			calc_CH_8_TO_9();		// Calculate next RG_LED_2 color
+#endif
+#if CAP_TOUCH
+			for (step = progSteps[touchProg]; step && !hostCtl; --step) {
+#else
+			if (!hostCtl) {			// Unless a host is driving req[]
+#endif
+#if GEN_SHOW
+				calc_show();		// Next step of every group, show.h
+#else
+				calc_CH_0_TO_2();	// Calculate next RGB_LED_1 color
+				calc_CH_3_TO_5();	// Calculate next RGB_LED_2 color
+				calc_CH_6_TO_7();	// Calculate next RG_LED_1 color
+				calc_CH_8_TO_9();	// Calculate next RG_LED_2 color
+#endif
+			}
+		}
+#if BLANKING
+		dimAcc += dimLvl;			// Light dimLvl of each 256 ticks,
+		if (dimAcc & 0x100) {		//   spread like a modulator output
+			dimAcc &= 0xFF;
+			calc_output_bits();	// Modulators only advance on lit ticks
 		}
+		else
+			outBits = 0;			// All LED's off, modulators frozen
+#else
 		calc_output_bits();	// Calculate next values for the modulators outputs
+#endif
+#if SWITCH_LIMIT
+		limit_switching();	// Defer pin changes over SWITCH_LIMIT
+#endif
+#if SD_ADC
+		calc_adc();			// Next ADC feedback bit, overrides P1.5
+#endif
+#if AMBIENT_DIM
+		if (!adcCnt)
+			calc_dim();			// New conversion, follow the room light
+#endif
+#if CAP_TOUCH
+		calc_touch();		// Same cost every tick, no ISR
+#endif
+
+		if (tickCnt - doneTick != 1)	// A tick went by without us
+			++lateCnt;
+		doneTick = tickCnt;			// Pass done, ISRs may take their time
+#if SOFT_UART
+		if (frmReady)
+			frame_commit();			// Frame done during this pass
+#endif
+#if I2C_SLAVE
+		if (i2cHeld)
+			i2c_scl_low();			// Bus was frozen during this pass
+#endif
+#if FLASH_CFG
+		cfg_step();					// At most one flash byte, ~75 us
+#endif
 	}
 }
 
-void init_all_CH_arrays() {
+#if GEN_SHOW
+const unsigned char showKey[SHOW_END][4] = { SHOW_KEYS };	// In flash
+const unsigned char showBegin[5] = { SHOW_BEGIN_0_2, SHOW_BEGIN_3_5,
+	SHOW_BEGIN_6_7, SHOW_BEGIN_8_9, SHOW_END };	// First key of each group
+const unsigned char showCh[5] = { 0, 3, 6, 8, N_CH };	// First channel
+
+void calc_show() {
 //------------------------------------------------------------------------------
-// Initialize all 10 channels arrays with different periods and initial values
+// Calculate next input values for all modulators from the keys of show.h
+//
+// Each key is the steps it lasts and the increment of each channel of its
+// group for one step, modulo 256 (a fall adds 256 - d); req[] wraps back
+// into 0 ... max on every step because host/showc.c has the compiler check
+// the levels of every key. The same adds as calc_CH_*(), plus a table read.
 //------------------------------------------------------------------------------
-	max[0] = MAX_CH_0_2;	// Set maxim value (resolution) for each modulator
-	max[1] = MAX_CH_0_2;
-	max[2] = MAX_CH_0_2;
-	max[3] = MAX_CH_3_5;
-	max[4] = MAX_CH_3_5;
-	max[5] = MAX_CH_3_5;
-	max[6] = MAX_CH_6_7;
-	max[7] = MAX_CH_6_7;
-	max[8] = MAX_CH_8_9;
-	max[9] = MAX_CH_8_9;
+	static unsigned char at[4] = { SHOW_BEGIN_0_2, SHOW_BEGIN_3_5,
+		SHOW_BEGIN_6_7, SHOW_BEGIN_8_9 };	// Key of each group
+	static unsigned char cnt[4];	// Steps done of that key
+	const unsigned char *k;
+	unsigned char g, n;
 
-	req[0] = MAX_CH_0_2;	// Initial RGB_LED_1 Red value
-	req[1] = 0;				// Initial RGB_LED_1 Green value
-	req[2] = 0;				// Initial RGB_LED_1 Blue value
-
-	req[3] = 0;				// Initial RGB_LED_2 Red value
-	req[4] = MAX_CH_3_5;	// Initial RGB_LED_2 Green value
-	req[5] = MAX_CH_3_5;	// Initial RGB_LED_2 Blue value
-
-	req[6] = 0;				// Initial RG_LED_1 Red value
-	req[7] = 0;				// Initial RG_LED_1 Green value
-
-	req[8] = MAX_CH_8_9;	// Initial RG_LED_2 Red value
-	req[9] = MAX_CH_8_9;	// Initial RG_LED_2 Green value
+	for (g = 0; g < 4; ++g) {
+		k = showKey[at[g]];
+		for (n = showCh[g]; n < showCh[g + 1]; ++n)
+			req[n] += *++k;
+		if (++cnt[g] >= showKey[at[g]][0]) {
+			cnt[g] = 0;
+			if (++at[g] == showBegin[g + 1])
+				at[g] = showBegin[g];	// Group starts over
+		}
+	}
 }
-
+#else
 void calc_CH_0_TO_2() {
 //------------------------------------------------------------------------------
 // Calculate next input values for modulators 0, 1, 2 (RGB_LED_1 color envelope)
@@ -253,31 +837,907 @@ void calc_CH_8_TO_9() {
 	
 	if (++stCnt >= 4*STEPS_CH_8_9) stCnt = 0;    //++stCnt modulo 4*STEPS_CH_8_9
 }
+#endif
+
+//------------------------------------------------------------------------------
+// Modulation policies: one step of channel n, m = max[n], that sets the LSB
+// of outBits for a lit tick. MOD_GROUP() pastes the policy of a group into
+// its own loop, so each group runs its scheme inline, with no test of the
+// policy per channel or tick.
+//------------------------------------------------------------------------------
+#if DITHER
+#define MOD_1(n, m)		/* MOD_DS1, threshold m + 0 ... DITHER_MASK */		\
+	sum[n] += req[n];													\
+	rnd = rnd & 1 ? (rnd >> 1) ^ DITHER_TAPS : rnd >> 1;				\
+	if (sum[n] < (m) + (rnd & DITHER_MASK))								\
+		outBits++;														\
+	else																\
+		sum[n] -= (m);
+#else
+#define MOD_1(n, m)		/* MOD_DS1, "synthetic division" */				\
+	sum[n] += req[n];				/* Update integrator value */		\
+	if (sum[n] < (m))													\
+		outBits++;														\
+	else																\
+		sum[n] -= (m);				/* Adjust integrator */
+#endif
+
+#define MOD_2(n, m)		/* MOD_DS2, errors fed back through ntf.h */		\
+	r = req[n];															\
+	e = ntfErr[n];														\
+	if (r < (int)((m) >> NTF_EDGE) || r > (int)((m) - ((m) >> NTF_EDGE)))	\
+		v = r - e[0];				/* First order near the edges */	\
+	else																\
+		v = NTF_V(r, e);												\
+	for (k = NTF_ORDER - 1; k; --k)										\
+		e[k] = e[k - 1];												\
+	if (v < (int)(((m) + 1) >> 1)) {									\
+		outBits++;					/* Quantized to 0 */				\
+		e[0] = -v;														\
+	}																	\
+	else																\
+		e[0] = (m) - v;				/* Quantized to max */
+
+#define MOD_3(n, m)		/* MOD_PWM, period counter 0 ... m - 1 */			\
+	if (++sum[n] >= (m))												\
+		sum[n] = 0;														\
+	if (sum[n] >= req[n])												\
+		outBits++;
+
+#define MOD_4(n, m)		/* MOD_PDM, bit-reversed counter 1 ... m */		\
+	sum[n] &= (m);					/* A host may have lowered max */	\
+	for (b = ((m) + 1) >> 1; sum[n] & b; b >>= 1)						\
+		sum[n] ^= b;				/* Reversed increment */			\
+	if (!(sum[n] |= b))													\
+		sum[n] = ((m) + 1) >> 1;	/* Skip 0 */						\
+	if (sum[n] <= (m) - req[n])											\
+		outBits++;
+
+#define MOD_5(n, m)		/* MOD_BAM, slot 1 ... m, weight in the high byte */	\
+	p = (sum[n] & 0xFF) + 1;											\
+	w = sum[n] >> 8;													\
+	if (p > (m) || !w)													\
+		p = w = 1;					/* Next period */					\
+	else if (p == w << 1)												\
+		w = p;						/* Next slot, twice as long */		\
+	sum[n] = w << 8 | p;												\
+	if (((m) - req[n]) & w)												\
+		outBits++;
+
+#define MOD_GROUP(p, first, last)	MOD_GROUP_(p, first, last)
+#define MOD_GROUP_(p, first, last)										\
+	for (n = (last); n >= (first); --n) {								\
+		outBits <<= 1;				/* Shift previously calculated bits */	\
+		m = max[n];														\
+		MOD_##p(n, m)													\
+	}
 
 void calc_output_bits() {
 //------------------------------------------------------------------------------
-// Calculate the output bit for each Delta-Sigma modulator
+// Calculate the output bit for each modulator, one group after the other
+//
+// MOD_DS1 is the first-order delta-sigma modulator. With DITHER its
+// threshold is max plus 0 ... DITHER_MASK, a new value for each channel
+// and tick. The integrator still only gains req and loses max, so it stays
+// bounded and the average output is exact; only the order of the bits
+// changes. About 8 cycles per channel (LFSR shift, conditional XOR, mask,
+// add), the LFSR is kept in a register for the loop.
+//
+// With MOD_DS2 the quantizer input is req plus the past errors (output
+// minus input of the quantizer) through the taps of NTF_V(). Below
+// max >> NTF_EDGE and above max minus that only the last error is fed
+// back, which is MOD_DS1 with sum = v + max/2. Both have NTF(1) = 0, so
+// the average is exact; host/ntf.c checks that the errors stay bounded at
+// every level and on ramps. About 25 cycles per channel more.
+//
+// The others count through a period of max ticks in sum[n] and are lit on
+// max - req of them: MOD_PWM in one pulse, MOD_PDM where a bit-reversed
+// count is at most max - req, which spreads them evenly over the period,
+// and MOD_BAM in slots of 1, 2, 4 ... ticks for the bits of max - req.
+// About 5, 15 and 10 cycles per channel more.
 //------------------------------------------------------------------------------
 	int n;						// Modulator (channel) number
+	unsigned int m;				// max[n], read once, a host may change it
+#if DITHER
+	unsigned int rnd = ditherRnd;
+#endif
+#if MOD_USED(MOD_DS2)
+	int v, r, k;
+	int *e;
+#endif
+#if MOD_USED(MOD_PDM)
+	unsigned int b;
+#endif
+#if MOD_USED(MOD_BAM)
+	unsigned int p, w;
+#endif
 
-	for (n = N_CH - 1; n >= 0; --n) {	// For each Delta-Sigma modulator
-		outBits <<= 1;			// Shift previously calculated bits
-// Sigma delta modulation algorithm using "synthetic division"
-		sum[n] += req[n];		// Update integrator value
-		if (sum[n] < max[n])
-			outBits++;			// LSB = 1
-		else
-			sum[n] -= max[n];	// LSB = 0 (untouched) and adjust integrator
+	MOD_GROUP(MOD_CH_8_9, 8, 9);	// From channel 9 down to 0, LSB last
+	MOD_GROUP(MOD_CH_6_7, 6, 7);
+	MOD_GROUP(MOD_CH_3_5, 3, 5);
+	MOD_GROUP(MOD_CH_0_2, 0, 2);
+#if DITHER
+	ditherRnd = rnd;
+#endif
+}
+
+#if SWITCH_LIMIT
+void limit_switching() {
+//------------------------------------------------------------------------------
+// Keep the pins that would change on the next tick to SWITCH_LIMIT
+//
+// Each channel carries a debt of -1, 0 or +1 ticks of light: the one it is
+// owed (swOwedOn) or owes (swOwedOff) for a change that was held back. The
+// wanted level is the modulator bit, or the debt paid back; a channel whose
+// change was held keeps its pin and takes the debt. A channel that already
+// has the debt of that direction must change, so the debt stays within one
+// tick and the average lit time is exact; these few can take the count
+// over the limit. The others are held in turn from a rotating channel, so
+// no channel is held more than the rest. One pass over the channels for
+// the count and at most one to hold, ~150 cycles at most.
+//------------------------------------------------------------------------------
+	unsigned int want, flip, must, bit, m;
+	int cnt, n;
+
+	want = (outBits | swOwedOn) & ~swOwedOff;	// Bits with the debts paid
+	flip = (want ^ swPrev) & SW_MASK;
+	must = flip & ((swOwedOn & outBits) | (swOwedOff & ~outBits));
+	swOwedOn &= outBits;			// Debts left once want is output
+	swOwedOff &= ~outBits;
+	for (cnt = 0, m = flip; m; m &= m - 1)
+		++cnt;
+	flip &= ~must;
+	bit = swFirst;
+	for (n = N_CH; cnt > SWITCH_LIMIT && n; --n) {
+		if (flip & bit) {
+			want ^= bit;			// Hold the pin, take the debt
+			if (want & bit)
+				swOwedOff |= bit;
+			else
+				swOwedOn |= bit;
+			--cnt;
+		}
+		bit <<= 1;
+		if (bit == 1 << N_CH)
+			bit = 1;
+	}
+	swFirst = bit;
+	outBits = (outBits & ~((1 << N_CH) - 1)) | want;
+	swPrev = outBits;
+}
+#endif
+
+#if SD_ADC
+void init_adc() {
+//------------------------------------------------------------------------------
+// Comparator_A+: 0.5 Vcc reference on +, CA4 (P1.4) on -, output filter on
+//------------------------------------------------------------------------------
+	CAPD |= ADC_IN;					// No digital input buffer on P1.4
+	CACTL2 = P2CA3 + CAF;			// CA4 to the - terminal
+	CACTL1 = CAREF_2 + CAON;		// 0.5 Vcc to the + terminal
+}
+
+void calc_adc() {
+//------------------------------------------------------------------------------
+// First-order delta-sigma ADC. The RC node on P1.4 is the integrator, the
+// comparator is the quantizer and P1.5 is the 1-bit DAC, written by the WDT
+// ISR together with the LEDs. It balances the input current, so the P1.5
+// duty cycle is 1 - Vin/Vcc. A sinc2 filter decimates the bits by ADC_OSR.
+//------------------------------------------------------------------------------
+	unsigned int c1, c2;
+
+	if (CACTL2 & CAOUT) {			// Integrator below Vcc/2, charge it
+		outBits ^= (outBits ^ ~P1_COMM_ANOD) & ADC_FB;	// P1.5 high
+		++adcI1;
+	}
+	else
+		outBits ^= (outBits ^ P1_COMM_ANOD) & ADC_FB;	// P1.5 low
+	adcI2 += adcI1;
+
+	if (++adcCnt & (ADC_OSR - 1))
+		return;
+	adcCnt = 0;						// Conversion done, run the combs
+	c1 = adcI2 - adcD1;
+	adcD1 = adcI2;
+	c2 = c1 - adcD2;				// High bits in the last 2*ADC_OSR ticks,
+	adcD2 = c1;						//   triangle weighted, 0 ... ADC_OSR**2
+	c2 = (ADC_OSR * ADC_OSR - c2) / (ADC_OSR * ADC_OSR / 256);
+	adcVal = c2 > 255 ? 255 : c2;
+}
+#endif
+
+#if AMBIENT_DIM
+void calc_dim() {
+//------------------------------------------------------------------------------
+// Scale all channels to the room light. Rather than touching req[] or max[],
+// whole ticks are blanked: the modulators skip them, so each channel shows
+// its own bit stream unchanged, only stretched by 256/dimLvl, and its
+// brightness scales by dimLvl/256 at no cost per channel. A first-order
+// filter over 2**DIM_TC conversions (about 1 s) moves dimLvl in small
+// steps, so a lamp switched on or a passing shadow fades instead of jumps.
+//------------------------------------------------------------------------------
+	unsigned int lvl = adcVal + 1;	// 1 ... 256, bright room = full
+
+	if (lvl < DIM_MIN)
+		lvl = DIM_MIN;
+	dimFilt += lvl - (dimFilt >> DIM_TC);
+	dimLvl = dimFilt >> DIM_TC;
+#if CAP_TOUCH
+	dimLvl >>= touchDim;			// Brightness picked on the touch pad
+	if (dimLvl < DIM_MIN)
+		dimLvl = DIM_MIN;
+#endif
+}
+#endif
+
+#if CAP_TOUCH
+void init_touch() {
+//------------------------------------------------------------------------------
+// P1.1 as TA0.0: output OUT = 1 charges the pad, input goes to CCI0A. The
+// pull-down discharges the pad while it is an input.
+//------------------------------------------------------------------------------
+	P1SEL |= TOUCH_PAD;
+	P1REN |= TOUCH_PAD;				// P1OUT.1 = 0 selects the pull-down
+	TACTL = TASSEL_2 + MC_2;		// SMCLK, continuous mode
+	TACCTL0 = TOUCH_CAPTURE;
+}
+
+void calc_touch() {
+//------------------------------------------------------------------------------
+// Capacitive touch without extra parts. Each tick the pad is charged and then
+// discharged through the internal pull-down (~35k); Timer_A captures the
+// falling edge in hardware and the next tick reads it. No ISR is involved,
+// so the WDT tick keeps its latency, and every call takes the same path
+// apart from a few compares (see the profile of host/sim_touch.c).
+//
+// A finger adds capacitance and slows the discharge by a few cycles.
+// touchBase follows the untouched time: at once downwards, one step each
+// 64 ticks upwards. A tap of TOUCH_MIN ticks or more selects the next
+// program on release; holding the pad steps the brightness every
+// TOUCH_LONG ticks instead.
+//------------------------------------------------------------------------------
+	unsigned int t = TOUCH_MAX;
+
+	if (TACCTL0 & CCIFG)			// Previous discharge, if it ended
+		t = TACCR0 - touchT0;
+	if (t > TOUCH_MAX)
+		t = TOUCH_MAX;
+	P1DIR |= TOUCH_PAD;				// Charge the pad
+	TACCTL0 = TOUCH_CAPTURE;		// Clear CCIFG and COV
+	touchT0 = TAR;
+	P1DIR &= ~TOUCH_PAD;			// Release, discharge starts
+
+	touchAvg += t - (touchAvg >> TOUCH_AVG);
+	if (!touchBase)
+		touchBase = touchAvg = t << TOUCH_AVG;	// First reading
+
+	if (touchAvg > touchBase + (touchCnt ? TOUCH_OFF : TOUCH_ON)) {
+		if (++touchCnt < TOUCH_LONG)
+			return;
+		touchCnt = 1;				// Held, next brightness level
+		touchLong = 1;
+		if (++touchDim >= TOUCH_DIMS)
+			touchDim = 0;
+#if FLASH_CFG
+		cfg_changed();
+#endif
+#if !AMBIENT_DIM
+		dimLvl = 256 >> touchDim;	// Else from the next conversion
+#endif
+		return;
+	}
+
+	if (touchCnt >= TOUCH_MIN && !touchLong) {
+		if (++touchProg >= N_PROG)	// Tap released, next program
+			touchProg = 0;
+#if FLASH_CFG
+		cfg_changed();
+#endif
+	}
+	touchCnt = 0;
+	touchLong = 0;
+	if (touchAvg < touchBase)
+		touchBase = touchAvg;
+	else if (touchAvg > touchBase && !(tickCnt & 63))
+		++touchBase;
+}
+#endif
+
+#if FLASH_CFG
+void cfg_load() {
+//------------------------------------------------------------------------------
+// Settings are a log of CFG_REC byte records in INFO segments D, C and B:
+//		seq, max[0..N_CH-1], program, brightness, unused (0xFF), sum
+// where sum is the 8 bit sum of all bytes before it. Records are written in
+// order and the seq byte last, so a record cut short by a power loss still
+// has seq = 0xFF and is skipped. The newest valid record is applied here.
+//
+// A segment erase holds the CPU for ~12 ms, so it is only done here, before
+// the first tick: the segments that do not hold the newest record are
+// erased, which leaves at least 2 * CFG_PER_SEG free slots for the saves of
+// this power cycle. Bounded: CFG_SLOTS records checked, 2 erases at most.
+//------------------------------------------------------------------------------
+	unsigned char *p, *rec = 0;
+	unsigned char i, n, chk, seg;
+
+	FCTL2 = FWKEY + FSSEL_1 + CFG_FN;	// MCLK / 40, 257 ... 476 kHz needed
+
+	for (i = 0, p = INFO_D; i < CFG_SLOTS; ++i, p += CFG_REC) {
+		if (p[0] == 0xFF)
+			continue;				// Free, or cut short
+		for (n = 0, chk = 0; n < CFG_SUM; ++n)
+			chk += p[n];
+		if (chk == p[CFG_SUM] && (!rec || (signed char)(p[0] - rec[0]) > 0)) {
+			rec = p;				// Valid and newer
+			cfgSlot = i;
+		}
+	}
+
+	if (rec) {
+		for (n = 0; n < N_CH; ++n)
+			if (rec[1 + n] >= CFG_MAX_MIN(n)) {
+				max[n] = rec[1 + n];
+#if MOD_USED(MOD_DS2)
+				for (i = 0; i < NTF_ORDER; ++i)
+					ntfErr[n][i] = 0;	// Settled, new max
+#endif
+#if !MOD_ALL(MOD_DS2)
+				sum[n] = (max[n] >> 1) + DITHER_MID;	// Settled, new max
+#endif
+				if (req[n] > max[n])
+					req[n] = max[n];
+			}
+#if CAP_TOUCH
+		if (rec[CFG_PROG] < N_PROG)
+			touchProg = rec[CFG_PROG];
+		if (rec[CFG_DIM] < TOUCH_DIMS)
+			touchDim = rec[CFG_DIM];
+#if !AMBIENT_DIM
+		dimLvl = 256 >> touchDim;
+#endif
+#endif
+		cfgSeq = rec[0];
+		seg = cfgSlot / CFG_PER_SEG;
+		++cfgSlot;					// Next slot, if it is still erased
+		for (n = 0, p = rec + CFG_REC; n < CFG_REC &&
+				cfgSlot % CFG_PER_SEG; ++n)
+			if (p[n] != 0xFF)
+				cfgSlot += CFG_PER_SEG - cfgSlot % CFG_PER_SEG;
+	}
+	else {
+		cfgSeq = 0xFE;				// First record gets seq 0
+		seg = CFG_SEGS;				// Keep none
+		cfgSlot = 0;
+	}
+	cfgLeft = (seg == CFG_SEGS ? 0 : seg * CFG_PER_SEG) + CFG_SLOTS - cfgSlot;
+	cfgSlot %= CFG_SLOTS;
+
+	for (i = 0, p = INFO_D; i < CFG_SEGS; ++i, p += CFG_SEG_SIZE) {
+		if (i == seg)
+			continue;
+		for (n = 0; n < CFG_SEG_SIZE && p[n] == 0xFF; ++n)
+			;
+		if (n < CFG_SEG_SIZE)
+			flash_erase(p + n);		// Not blank yet
+	}
+}
+
+void cfg_changed() {
+//------------------------------------------------------------------------------
+// A setting changed, save all of them once nothing changed for CFG_DELAY ticks
+//------------------------------------------------------------------------------
+	cfgWait = CFG_DELAY;
+}
+
+void cfg_max(unsigned char n, unsigned char val) {
+//------------------------------------------------------------------------------
+// New resolution for channel n from a host, req[n] clamped to it. The
+// envelopes step req[n] by INC_CH_* up to MAX_CH_* whatever max[n] is, so a
+// lower one is refused as a link error.
+//------------------------------------------------------------------------------
+	if (val < CFG_MAX_MIN(n)) {
+		++errCnt;
+		return;
+	}
+	max[n] = val;					// Word store, calc_output_bits() reads
+	if (req[n] > val)				//   it once per step
+		req[n] = val;
+	cfg_changed();
+}
+
+void cfg_step() {
+//------------------------------------------------------------------------------
+// Called once per tick, right after the pass, writes at most one byte of a
+// record. A byte write holds the CPU for 30 flash clocks (75 us), which ends
+// long before the next tick, so the output never slips. Interrupts wait
+// meanwhile, so nothing is written while a host message is under way: a
+// software UART char or an I2C transfer would lose bits.
+//
+// Once the slots erased at boot are used up, a change stays unsaved until
+// the next boot (at CFG_DELAY per save that takes a dozen or more changes).
+//------------------------------------------------------------------------------
+	unsigned char b;
+
+	if (!cfgPos) {
+		if (!cfgWait || --cfgWait)
+			return;
+		if (!cfgLeft) {
+			cfgWait = 1;			// Log full until the next boot
+			return;
+		}
+		if (++cfgSeq == 0xFF)
+			cfgSeq = 0;
+		cfgSum = cfgSeq;
+		cfgPos = 1;
+	}
+#if SOFT_UART
+	if (uartCh < UART_CH_HUNT || !(TACCTL1 & CAP))
+		return;						// Inside a command or a char
+#endif
+#if I2C_SLAVE
+	if (i2cState != I2C_IDLE)
+		return;
+#endif
+
+	if (cfgPos <= N_CH)
+		b = max[cfgPos - 1] > 0xFF ? 0xFF : max[cfgPos - 1];
+#if CAP_TOUCH
+	else if (cfgPos == CFG_PROG)
+		b = touchProg;
+	else if (cfgPos == CFG_DIM)
+		b = touchDim;
+#endif
+	else if (cfgPos == CFG_SUM)
+		b = cfgSum;
+	else if (cfgPos == CFG_REC)
+		b = cfgSeq;					// Last, makes the record valid
+	else {
+		cfgSum += 0xFF;				// Unused byte, left erased
+		++cfgPos;
+		return;
 	}
+	cfgSum += b;
+	flash_write(INFO_D + cfgSlot * CFG_REC + (cfgPos & (CFG_REC - 1)), b);
+
+	if (++cfgPos <= CFG_REC)
+		return;
+	cfgPos = 0;						// Record done
+	if (++cfgSlot == CFG_SLOTS)
+		cfgSlot = 0;
+	--cfgLeft;
+}
+
+void flash_write(unsigned char *p, unsigned char val) {
+//------------------------------------------------------------------------------
+// Program one byte, the CPU is held until it is done
+//------------------------------------------------------------------------------
+	FCTL3 = FWKEY;					// Unlock, LOCKA is left set
+	FCTL1 = FWKEY + WRT;
+	*p = val;
+	FCTL1 = FWKEY;
+	FCTL3 = FWKEY + LOCK;
+}
+
+void flash_erase(unsigned char *p) {
+//------------------------------------------------------------------------------
+// Erase the 64 byte segment that holds p, the CPU is held ~12 ms
+//------------------------------------------------------------------------------
+	FCTL3 = FWKEY;
+	FCTL1 = FWKEY + ERASE;
+	*p = 0xFF;						// Dummy write starts the erase
+	FCTL1 = FWKEY;
+	FCTL3 = FWKEY + LOCK;
 }
+#endif
+
+#if SPREAD_TICK
+#pragma vector = TIMERA0_VECTOR
+__interrupt void Timer_A0(void) {
+//------------------------------------------------------------------------------
+// Timer_A CCR0 ISR - the tick with SPREAD_TICK, same job as Watchdog_Timer().
+// The next compare is SPREAD_MIN plus 0 ... 255 steps of SPREAD_RANGE / 256
+// cycles later (8 at the default 8192, TICK_CYCLES +-1/8 at any period),
+// the top byte of an LCG (x * 5 + odd has the full period of 65536, and
+// over it each top byte comes 256 times), so the mean period is exactly
+// TICK_CYCLES (half a cycle more when the step is odd). The modulators
+// count ticks, and as the period does not depend on the output bits, the
+// lit time still averages to the level.
+// Counted from the last compare, ISR latency does not add up.
+//------------------------------------------------------------------------------
+	P1OUT = (outBits ^ P1_COMM_ANOD) & P1_LEDS;	// Negate common anode LED's bits
+	P2OUT = (outBits >> 2) ^ P2_COMM_ANOD;	// Negate common anode LED's bits
 
+	tickRnd = tickRnd * 5 + 13849;
+	TACCR0 += SPREAD_MIN + ((tickRnd >> 8) & 0xFF) * (SPREAD_RANGE / 256);
+	++tickCnt;
+#else
 #pragma vector = WDT_VECTOR
 __interrupt void Watchdog_Timer(void) {
 //------------------------------------------------------------------------------
 // Watchdog Timer ISR - Write the modulators outputs to P1 and P2 (all LED's)
 //------------------------------------------------------------------------------
-	P1OUT = outBits ^ P1_COMM_ANOD;			// Negate common anode LED's bits
+	P1OUT = (outBits ^ P1_COMM_ANOD) & P1_LEDS;	// Negate common anode LED's bits
 	P2OUT = (outBits >> 2) ^ P2_COMM_ANOD;	// Negate common anode LED's bits
 
+	++tickCnt;
+#endif
+
 	_BIC_SR_IRQ(LPM0_bits);					// Clear LPM0 bits from 0(SR)
 }
+
+#if SOFT_UART || I2C_SLAVE
+void host_ctl(unsigned char on) {
+//------------------------------------------------------------------------------
+// Hand req[] to a host (on != 0) or back to the envelopes. calc_CH_*() step
+// req[] from where they left it, so their levels wait in envReq[] meanwhile:
+// resuming from the host's levels would run them past max[]. Called before
+// the host's first req[] store.
+//------------------------------------------------------------------------------
+	unsigned char n;
+
+	if (on && !hostCtl)
+		for (n = 0; n < N_CH; ++n)
+			envReq[n] = req[n];
+	else if (!on && hostCtl)
+		for (n = 0; n < N_CH; ++n)
+			req[n] = envReq[n];
+	hostCtl = on != 0;
+}
+#endif
+
+#if SOFT_UART
+void init_uart() {
+//------------------------------------------------------------------------------
+// Route P1.2 to Timer_A capture input CCI1A and wait for the autobaud char
+//------------------------------------------------------------------------------
+	P1DIR &= ~UART_RXD;				// P1.2 is an input
+	P1SEL |= UART_RXD;				// P1.2 = CCI1A
+
+	TACTL = TASSEL_2 + MC_2;		// SMCLK, continuous mode
+	uartBit = 0;					// Measure the bit length first
+	uartCnt = 0;
+	TACCTL1 = SCS + CM_2 + CAP + CCIE;	// Capture falling edges
+}
+
+void uart_rx(unsigned char c) {
+//------------------------------------------------------------------------------
+// Decode one received char. Commands are two bytes long:
+//		0x80 + n, value		- req[n] = value (clamped to max[n])
+//		0x80 + 0x7F, value	- hostCtl = value (0 = resume the envelopes)
+//		0xC0 + n, value		- max[n] = value (MAX_CH_* ... 255, FLASH_CFG only)
+// or a frame that updates many channels at once:
+//		0x80 + 0x7E, ...	- see frame_rx()
+// Any request update hands req[] over to the host.
+//------------------------------------------------------------------------------
+	if (uartCh >= UART_CH_HUNT) {	// Idle, or resyncing after a bad frame
+		if ((c & 0x80) &&
+				(uartCh == UART_CH_IDLE || c == 0x80 + UART_CH_FRAME)) {
+			uartCh = c & 0x7F;		// Command byte, value comes next
+			frmPos = FRM_MAP_LO;
+			frmCrc = 0;
+		}
+		return;						// Stray value bytes are dropped
+	}
+
+	if (uartCh == UART_CH_FRAME) {
+		frame_rx(c);
+		return;
+	}
+
+	if (uartCh < N_CH) {
+		if (c > max[uartCh]) c = max[uartCh];
+		host_ctl(1);
+		req[uartCh] = c;			// Single byte store, safe for the tick
+	}
+	else if (uartCh == UART_CH_HOST)
+		host_ctl(c);
+#if FLASH_CFG
+	else if ((unsigned char)(uartCh - UART_CH_MAX) < N_CH)
+		cfg_max(uartCh - UART_CH_MAX, c);
+#endif
+
+	uartCh = UART_CH_IDLE;
+}
+
+void frame_rx(unsigned char c) {
+//------------------------------------------------------------------------------
+// Decode one byte of a frame:
+//		0x80 + 0x7E, map low, map high, values, CRC
+// with one value (clamped to max[n]) for each channel n set in the bitmap, in
+// ascending order, and the CRC-8 of the bitmap and the values (polynomial
+// 0x07, initial value 0, the SMBus PEC). Values wait in frmVal[] until the
+// CRC has been checked; frame_commit() then copies them to req[] between
+// two modulator steps, so all channels of a frame change on the same tick.
+// A bad frame counts in errCnt and bytes are dropped until the next frame.
+//------------------------------------------------------------------------------
+	if (frmPos == FRM_CRC) {
+		uartCh = UART_CH_IDLE;
+		if (c == frmCrc) {
+			frmReady = 1;
+			_BIC_SR_IRQ(LPM0_bits);	// Main loop commits it before its next
+			return;					//   modulator step
+		}
+		uartCh = UART_CH_HUNT;
+		++errCnt;
+		return;
+	}
+
+	frmCrc ^= c;
+	frmCrc = (frmCrc << 4) ^ crcNib[frmCrc >> 4];
+	frmCrc = (frmCrc << 4) ^ crcNib[frmCrc >> 4];
+
+	if (frmPos == FRM_MAP_LO) {
+		frmMap = c;
+		frmPos = FRM_MAP_HI;
+		return;
+	}
+	if (frmPos == FRM_MAP_HI) {
+		frmMap |= (unsigned int)c << 8;
+		if ((frmMap >> N_CH) || frmReady) {	// No such channel, or the last
+			uartCh = UART_CH_HUNT;			//   frame still in frmVal[]
+			++errCnt;
+			return;
+		}
+		frmBits = frmMap;
+		frmPos = 0;
+	}
+	else {
+		if (c > max[frmPos]) c = max[frmPos];
+		frmVal[frmPos] = c;
+		frmBits >>= 1;
+		++frmPos;
+	}
+
+	while (frmBits && !(frmBits & 1)) {	// Next channel in the bitmap
+		frmBits >>= 1;
+		++frmPos;
+	}
+	if (!frmBits)
+		frmPos = FRM_CRC;
+}
+
+void frame_commit() {
+//------------------------------------------------------------------------------
+// Copy a checked frame to req[], only called between two modulator steps
+//------------------------------------------------------------------------------
+	unsigned int map = frmMap;
+	unsigned char n;
+
+	host_ctl(1);
+	for (n = 0; map; ++n, map >>= 1)
+		if (map & 1)
+			req[n] = frmVal[n];
+	frmReady = 0;					// frmVal[] free for the next frame
+}
+
+#pragma vector = TIMERA1_VECTOR
+__interrupt void Timer_A1(void) {
+//------------------------------------------------------------------------------
+// Timer_A CCR1 ISR - software UART receiver, one interrupt per edge or bit.
+//
+// Autobaud:	capture the falling edges of UART_SYNC (0x55); the 1st and
+//				the 5th are 8 bits apart, so uartBit = delta >> 3.
+// Start bit:	capture the falling edge, then switch to compare mode and
+//				sample the middle of each bit from SCCI.
+// Stop bit:	a low stop bit is a framing error and restarts the autobaud.
+//
+// Each pass is a few instructions, so the WDT tick is held off by a few us
+// at most, even at 115200 baud (see host/sim_uart.c for the budget check).
+//------------------------------------------------------------------------------
+	if (TAIV != TAIV_TACCR1)
+		return;
+
+	if (TACCTL1 & CAP) {			// Falling edge captured
+		if (!uartBit) {				// Autobaud in progress
+			if (!uartCnt)
+				uartT0 = TACCR1;	// First edge of UART_SYNC
+			else if (uartCnt == 4)
+				uartBit = (TACCR1 - uartT0) >> 3;
+			if (++uartCnt > 4)
+				uartCnt = 0;
+			return;
+		}
+		TACCR1 += uartBit + (uartBit >> 1);	// Middle of data bit 0
+		TACCTL1 = SCS + CCIE;		// Compare mode, SCCI latches RXD
+		uartCnt = 9;				// 8 data bits and the stop bit
+		return;
+	}
+
+	TACCR1 += uartBit;				// Middle of the next bit
+	if (--uartCnt) {				// Data bit
+		uartByte >>= 1;
+		if (TACCTL1 & SCCI)
+			uartByte |= 0x80;
+		return;
+	}
+
+	if (!(TACCTL1 & SCCI))			// Low stop bit, framing error
+	{
+		uartBit = 0;				//   measure the bit length again
+		++errCnt;
+	}
+	TACCTL1 = SCS + CM_2 + CAP + CCIE;	// Wait for the next start bit
+	if (uartBit)
+		uart_rx(uartByte);
+}
+#endif
+
+#if I2C_SLAVE
+void init_i2c() {
+//------------------------------------------------------------------------------
+// Both lines released (inputs, P1OUT = 0), interrupt on the next edges
+//------------------------------------------------------------------------------
+	P1DIR &= ~(I2C_SCL + I2C_SDA);
+	P1OUT &= ~(I2C_SCL + I2C_SDA);
+	P1IES |= I2C_SCL + I2C_SDA;		// Both idle high, next edge is falling
+	P1IFG &= ~(I2C_SCL + I2C_SDA);
+	P1IE |= I2C_SCL + I2C_SDA;
+	i2cState = I2C_IDLE;
+}
+
+unsigned char i2c_read(unsigned char reg) {
+//------------------------------------------------------------------------------
+// Register map, reads past the end return 0:
+//		0x00..0x09	req[]		0x20	tickCnt low		0x22	lateCnt
+//		0x10		hostCtl		0x21	tickCnt high	0x23	errCnt
+//		0x30..0x39	max[]
+//------------------------------------------------------------------------------
+	if (reg < I2C_REG_REQ + N_CH)
+		return req[reg - I2C_REG_REQ];
+	if (reg == I2C_REG_HOST)
+		return hostCtl;
+	if (reg == I2C_REG_STATS)
+		return tickCnt;
+	if (reg == I2C_REG_STATS + 1)
+		return tickCnt >> 8;
+	if (reg == I2C_REG_STATS + 2)
+		return lateCnt;
+	if (reg == I2C_REG_STATS + 3)
+		return errCnt;
+	if ((unsigned char)(reg - I2C_REG_MAX) < N_CH)
+		return max[reg - I2C_REG_MAX];
+	return 0;
+}
+
+void i2c_write(unsigned char reg, unsigned char val) {
+//------------------------------------------------------------------------------
+// Same map as i2c_read(); req[], hostCtl and max[] (FLASH_CFG) are writable
+//------------------------------------------------------------------------------
+	if (reg < I2C_REG_REQ + N_CH) {
+		reg -= I2C_REG_REQ;
+		if (val > max[reg]) val = max[reg];
+		host_ctl(1);
+		req[reg] = val;
+	}
+	else if (reg == I2C_REG_HOST)
+		host_ctl(val);
+#if FLASH_CFG
+	else if ((unsigned char)(reg - I2C_REG_MAX) < N_CH)
+		cfg_max(reg - I2C_REG_MAX, val);
+#endif
+	else
+		++errCnt;
+}
+
+void i2c_scl_low() {
+//------------------------------------------------------------------------------
+// Work for an SCL falling edge: handle a complete byte (ACK clock next) or
+// put the next bit on SDA. SCL is held low by the slave on entry, so the
+// master waits, and it is released on exit.
+//------------------------------------------------------------------------------
+	i2cHeld = 0;
+
+	if (i2cBits == 8) {				// Byte done, ACK clock is next
+		if (i2cState == I2C_READ)
+			P1DIR &= ~I2C_SDA;		// Release SDA for the master ACK
+		else {
+			if (i2cState == I2C_ADDR_BYTE) {
+				if ((i2cByte >> 1) != I2C_ADDR)
+					i2cState = I2C_IDLE;
+				else
+					i2cState = i2cByte & 1 ? I2C_READ : I2C_REG_BYTE;
+			}
+			else if (i2cState == I2C_REG_BYTE) {
+				i2cReg = i2cByte;
+				i2cState = I2C_WRITE;
+			}
+			else
+				i2c_write(i2cReg++, i2cByte);
+			if (i2cState != I2C_IDLE)
+				P1DIR |= I2C_SDA;	// ACK
+		}
+	}
+	else {
+		if (i2cBits == 9) {			// ACK clock done, next byte
+			i2cBits = 0;
+			P1DIR &= ~I2C_SDA;
+			if (i2cState == I2C_READ)
+				i2cByte = i2c_read(i2cReg++);
+		}
+		if (i2cState == I2C_READ) {	// Put the next bit on SDA, MSB first
+			if (i2cByte & 0x80)
+				P1DIR &= ~I2C_SDA;
+			else
+				P1DIR |= I2C_SDA;
+			i2cByte <<= 1;
+		}
+	}
+
+	P1DIR &= ~I2C_SCL;				// Release SCL
+}
+
+#pragma vector = PORT1_VECTOR
+__interrupt void Port_1(void) {
+//------------------------------------------------------------------------------
+// Port 1 ISR - I2C slave, one interrupt per SCL edge, and per SDA edge while
+// SCL is high.
+//
+// SDA edges with SCL high are START and STOP. SCL rising edges sample SDA.
+// On SCL falling edges the slave holds SCL low (clock stretching) until
+// i2c_scl_low() is done. While the main loop computes a tick that call is
+// left to the main loop, so the bus is frozen and can not steal the cycles
+// the tick needs; between ticks it is made right here.
+//
+// Stretching starts only when the ISR runs. A master faster than the
+// interrupt latency (100 kHz SCL) has moved SCL on again by then: SCL is
+// already back at the level the edge left. Such an overrun drops the
+// transfer and counts in errCnt; SDA stays released, so a write gets a NACK
+// and a read ends in 0xFF bytes, never in values taken for good ones.
+//------------------------------------------------------------------------------
+	unsigned char in = P1IN & (I2C_SCL + I2C_SDA);
+	unsigned char ifg = P1IFG & P1IE & (I2C_SCL + I2C_SDA);
+	unsigned char ies = P1IES;
+
+	P1IES = (P1IES & ~(I2C_SCL + I2C_SDA)) | in;	// Next: opposite edges
+	P1IFG &= ~(I2C_SCL + I2C_SDA);	// Writing P1IES may set the flags,
+	P1IFG |= (P1IN ^ in) & (I2C_SCL + I2C_SDA);	//   keep edges since then
+
+	if (ifg & I2C_SCL && !((ies ^ in) & I2C_SCL) && i2cState != I2C_IDLE) {
+		i2cState = I2C_IDLE;		// Overrun, SCL edge missed
+		P1DIR &= ~I2C_SDA;
+		if (in & I2C_SCL)
+			P1IE |= I2C_SDA;		// Watch for the STOP
+		++errCnt;
+		return;
+	}
+
+	if (ifg & I2C_SDA && in & I2C_SCL) {
+		if (in & I2C_SDA)			// STOP
+			i2cState = I2C_IDLE;
+		else {						// START or repeated START
+			i2cState = I2C_ADDR_BYTE;
+			i2cBits = 0;
+		}
+		return;
+	}
+
+	if (!(ifg & I2C_SCL))
+		return;
+
+	if (in & I2C_SCL) {				// Rising edge, SDA is valid
+		P1IE |= I2C_SDA;			// Watch for START and STOP
+		if (i2cState == I2C_IDLE)
+			return;
+		if (++i2cBits > 8) {		// ACK clock
+			if (i2cState == I2C_READ && in & I2C_SDA)
+				i2cState = I2C_IDLE;	// Master NACK, last byte was read
+		}
+		else if (i2cState != I2C_READ) {
+			i2cByte <<= 1;
+			if (in & I2C_SDA)
+				i2cByte++;
+		}
+		return;
+	}
+
+	P1IE &= ~I2C_SDA;				// Falling edge, SDA may change now
+	if (i2cState == I2C_IDLE)
+		return;
+	P1DIR |= I2C_SCL;				// Stretch the clock
+
+	if (tickCnt != doneTick)		// Main loop busy with a tick
+		i2cHeld = 1;
+	else
+		i2c_scl_low();
+}
+#endif
@@ -0,0 +1,21 @@
+//******************************************************************************
+//	Noise transfer function of the NTF_SHAPED modulators
+//
+//	Generated by host/ntf.c (-n 3), do not edit.
+//
+//	NTF(z) = 1 - 2 z^-1 + z^-2, first order below max >> 3 and above max - that
+//	Visible noise, mean over all levels: 0.0425 % (first order 0.0587 %)
+//	Worst level: 0.6052 % (first order 0.6052 %)
+//	Scored at every req of max 100 150 200,
+//	stable at every max 1 ... 255, |e| <= 4.00 max
+//******************************************************************************
+
+#ifndef NTF_H
+#define NTF_H
+
+#define NTF_ORDER		2
+#define NTF_EDGE		3
+#define NTF_ERR_MAX		5		// |e| < NTF_ERR_MAX * max
+#define NTF_V(x, e)		((x) - (e)[0] * 2 + (e)[1])
+
+#endif
@@ -0,0 +1,131 @@
+//******************************************************************************
+//	Show of main.c for GEN_SHOW, generated by host/showc.c from show.txt,
+//	do not edit.
+//
+//	20 keys, 80 bytes of flash
+//******************************************************************************
+
+#ifndef SHOW_H
+#define SHOW_H
+
+#define REQ_CH_0		MAX_CH_0_2
+#define REQ_CH_1		0
+#define REQ_CH_2		0
+#define REQ_CH_3		0
+#define REQ_CH_4		MAX_CH_3_5
+#define REQ_CH_5		MAX_CH_3_5
+#define REQ_CH_6		0
+#define REQ_CH_7		0
+#define REQ_CH_8		MAX_CH_8_9
+#define REQ_CH_9		MAX_CH_8_9
+
+#define SHOW_BEGIN_0_2	0
+#define SHOW_BEGIN_3_5	6
+#define SHOW_BEGIN_6_7	12
+#define SHOW_BEGIN_8_9	16
+#define SHOW_END		20
+
+#define SHOW_KEYS		/* Steps, increment of each channel */ \
+	/* show.txt:6 */ \
+	{ STEPS_CH_0_2, 0, SHOW_INC(0, MAX_CH_0_2, STEPS_CH_0_2), 0 }, \
+	/* show.txt:7 */ \
+	{ STEPS_CH_0_2, SHOW_INC(MAX_CH_0_2, 0, STEPS_CH_0_2), 0, 0 }, \
+	/* show.txt:8 */ \
+	{ STEPS_CH_0_2, 0, 0, SHOW_INC(0, MAX_CH_0_2, STEPS_CH_0_2) }, \
+	/* show.txt:9 */ \
+	{ STEPS_CH_0_2, 0, SHOW_INC(MAX_CH_0_2, 0, STEPS_CH_0_2), 0 }, \
+	/* show.txt:10 */ \
+	{ STEPS_CH_0_2, SHOW_INC(0, MAX_CH_0_2, STEPS_CH_0_2), 0, 0 }, \
+	/* show.txt:11 */ \
+	{ STEPS_CH_0_2, 0, 0, SHOW_INC(MAX_CH_0_2, 0, STEPS_CH_0_2) }, \
+	/* show.txt:14 */ \
+	{ STEPS_CH_3_5, 0, SHOW_INC(MAX_CH_3_5, 0, STEPS_CH_3_5), 0 }, \
+	/* show.txt:15 */ \
+	{ STEPS_CH_3_5, SHOW_INC(0, MAX_CH_3_5, STEPS_CH_3_5), 0, 0 }, \
+	/* show.txt:16 */ \
+	{ STEPS_CH_3_5, 0, 0, SHOW_INC(MAX_CH_3_5, 0, STEPS_CH_3_5) }, \
+	/* show.txt:17 */ \
+	{ STEPS_CH_3_5, 0, SHOW_INC(0, MAX_CH_3_5, STEPS_CH_3_5), 0 }, \
+	/* show.txt:18 */ \
+	{ STEPS_CH_3_5, SHOW_INC(MAX_CH_3_5, 0, STEPS_CH_3_5), 0, 0 }, \
+	/* show.txt:19 */ \
+	{ STEPS_CH_3_5, 0, 0, SHOW_INC(0, MAX_CH_3_5, STEPS_CH_3_5) }, \
+	/* show.txt:22 */ \
+	{ STEPS_CH_6_7, 0, SHOW_INC(0, MAX_CH_6_7, STEPS_CH_6_7), 0 }, \
+	/* show.txt:23 */ \
+	{ STEPS_CH_6_7, SHOW_INC(0, MAX_CH_6_7, STEPS_CH_6_7), 0, 0 }, \
+	/* show.txt:24 */ \
+	{ STEPS_CH_6_7, 0, SHOW_INC(MAX_CH_6_7, 0, STEPS_CH_6_7), 0 }, \
+	/* show.txt:25 */ \
+	{ STEPS_CH_6_7, SHOW_INC(MAX_CH_6_7, 0, STEPS_CH_6_7), 0, 0 }, \
+	/* show.txt:28 */ \
+	{ STEPS_CH_8_9, 0, SHOW_INC(MAX_CH_8_9, 0, STEPS_CH_8_9), 0 }, \
+	/* show.txt:29 */ \
+	{ STEPS_CH_8_9, SHOW_INC(MAX_CH_8_9, 0, STEPS_CH_8_9), 0, 0 }, \
+	/* show.txt:30 */ \
+	{ STEPS_CH_8_9, 0, SHOW_INC(0, MAX_CH_8_9, STEPS_CH_8_9), 0 }, \
+	/* show.txt:31 */ \
+	{ STEPS_CH_8_9, SHOW_INC(0, MAX_CH_8_9, STEPS_CH_8_9), 0, 0 }, \
+
+#if ((MAX_CH_0_2) - (0)) % (STEPS_CH_0_2)
+#error "show.txt:6: ramp of channel 1 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_0_2)) % (STEPS_CH_0_2)
+#error "show.txt:7: ramp of channel 0 is not a whole number of levels per step"
+#endif
+#if ((MAX_CH_0_2) - (0)) % (STEPS_CH_0_2)
+#error "show.txt:8: ramp of channel 2 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_0_2)) % (STEPS_CH_0_2)
+#error "show.txt:9: ramp of channel 1 is not a whole number of levels per step"
+#endif
+#if ((MAX_CH_0_2) - (0)) % (STEPS_CH_0_2)
+#error "show.txt:10: ramp of channel 0 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_0_2)) % (STEPS_CH_0_2)
+#error "show.txt:11: ramp of channel 2 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_3_5)) % (STEPS_CH_3_5)
+#error "show.txt:14: ramp of channel 4 is not a whole number of levels per step"
+#endif
+#if ((MAX_CH_3_5) - (0)) % (STEPS_CH_3_5)
+#error "show.txt:15: ramp of channel 3 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_3_5)) % (STEPS_CH_3_5)
+#error "show.txt:16: ramp of channel 5 is not a whole number of levels per step"
+#endif
+#if ((MAX_CH_3_5) - (0)) % (STEPS_CH_3_5)
+#error "show.txt:17: ramp of channel 4 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_3_5)) % (STEPS_CH_3_5)
+#error "show.txt:18: ramp of channel 3 is not a whole number of levels per step"
+#endif
+#if ((MAX_CH_3_5) - (0)) % (STEPS_CH_3_5)
+#error "show.txt:19: ramp of channel 5 is not a whole number of levels per step"
+#endif
+#if ((MAX_CH_6_7) - (0)) % (STEPS_CH_6_7)
+#error "show.txt:22: ramp of channel 7 is not a whole number of levels per step"
+#endif
+#if ((MAX_CH_6_7) - (0)) % (STEPS_CH_6_7)
+#error "show.txt:23: ramp of channel 6 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_6_7)) % (STEPS_CH_6_7)
+#error "show.txt:24: ramp of channel 7 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_6_7)) % (STEPS_CH_6_7)
+#error "show.txt:25: ramp of channel 6 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_8_9)) % (STEPS_CH_8_9)
+#error "show.txt:28: ramp of channel 9 is not a whole number of levels per step"
+#endif
+#if ((0) - (MAX_CH_8_9)) % (STEPS_CH_8_9)
+#error "show.txt:29: ramp of channel 8 is not a whole number of levels per step"
+#endif
+#if ((MAX_CH_8_9) - (0)) % (STEPS_CH_8_9)
+#error "show.txt:30: ramp of channel 9 is not a whole number of levels per step"
+#endif
+#if ((MAX_CH_8_9) - (0)) % (STEPS_CH_8_9)
+#error "show.txt:31: ramp of channel 8 is not a whole number of levels per step"
+#endif
+
+#endif